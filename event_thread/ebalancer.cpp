@@ -0,0 +1,150 @@
+#include "ebalancer.h"
+
+ethr::ELoadBalancer::ELoadBalancer(const std::vector<EThread*> &ethreads, const double &threshold)
+{
+    mEThreads = ethreads;
+    mThreshold = threshold;
+    mNMigrations = 0;
+    mPendingEObjectId = -1;
+    mPendingSourcePtr = nullptr;
+    mIsStopping = false;
+    for(auto* ethreadPtr : mEThreads)
+    {
+        ethreadPtr->setEObjectLoadTracking(true);
+        ethreadPtr->takeEObjectLoads();
+    }
+    mLastRebalanceTime = std::chrono::high_resolution_clock::now();
+}
+
+ethr::ELoadBalancer::~ELoadBalancer()
+{
+    stop();
+}
+
+void ethr::ELoadBalancer::pin(const EObject &eObject)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mPinnedEObjectIds.insert(eObject.id());
+}
+
+int ethr::ELoadBalancer::rebalance()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto now = std::chrono::high_resolution_clock::now();
+    auto periodNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - mLastRebalanceTime).count();
+    mLastRebalanceTime = now;
+    if(mEThreads.size() < 2)
+        return -1;
+
+    struct ThreadLoad
+    {
+        EThread *ethreadPtr;
+        int64_t loadNs;
+        std::vector<std::pair<int, int64_t>> eObjectLoadsNs;  // {id, load}
+    };
+    std::vector<ThreadLoad> threadLoads;
+    std::map<int, HandleHistory> handleHistories;
+    for(auto* ethreadPtr : mEThreads)
+    {
+        ThreadLoad threadLoad{ethreadPtr, 0, {}};
+        auto loads = ethreadPtr->takeEObjectLoads();
+        int64_t threadHandleTimeNs = 0;
+        uint64_t nThreadHandledEvents = 0;
+        for(auto& load : loads)
+        {
+            threadHandleTimeNs += load.handleTime.count();
+            nThreadHandledEvents += load.nHandledEvents;
+        }
+        for(auto& load : loads)
+        {
+            // the mean is weighted by events, so a few handlers stretched by preemption barely move it.
+            // an EObject that has not handled any event yet takes the mean of its thread
+            int64_t handleTimeNs = load.handleTime.count();
+            HandleHistory history{0, 0};
+            auto historyIter = mHandleHistories.find(load.eObjectId);
+            if(historyIter != mHandleHistories.end())
+                history = {historyIter->second.handleTimeNs / 2, historyIter->second.nHandledEvents / 2};
+            history.handleTimeNs += (double)handleTimeNs;
+            history.nHandledEvents += (double)load.nHandledEvents;
+            int64_t meanNs = 0;
+            if(history.nHandledEvents > 0)
+            {
+                meanNs = (int64_t)(history.handleTimeNs / history.nHandledEvents);
+                handleHistories[load.eObjectId] = history;
+            }
+            else if(nThreadHandledEvents > 0)
+            {
+                meanNs = threadHandleTimeNs / (int64_t)nThreadHandledEvents;
+            }
+            int64_t backlogNs = meanNs * (int64_t)load.nQueuedEvents;
+            threadLoad.loadNs += handleTimeNs + backlogNs;
+            threadLoad.eObjectLoadsNs.emplace_back(load.eObjectId, handleTimeNs + backlogNs);
+        }
+        threadLoads.push_back(std::move(threadLoad));
+    }
+    // the histories of the EObjects removed from the EThreads are dropped
+    mHandleHistories.swap(handleHistories);
+    // the loads are taken from where the EObjects were before a pending migration, which would be requested again
+    if(mPendingEObjectId >= 0)
+    {
+        if(mPendingSourcePtr->isMigrationPending(mPendingEObjectId))
+            return -1;
+        mPendingEObjectId = -1;
+        mPendingSourcePtr = nullptr;
+    }
+    auto [idlestIter, busiestIter] = std::minmax_element(threadLoads.begin(), threadLoads.end(),
+                                                         [](const auto &a, const auto &b){ return a.loadNs < b.loadNs; });
+    int64_t gapNs = busiestIter->loadNs - idlestIter->loadNs;
+    if(gapNs <= 0 || (double)gapNs < mThreshold * (double)periodNs)
+        return -1;
+
+    // moving a load of x leaves a gap of |gap - 2x|. an EObject heavier than the gap would only swap the roles
+    int migratedId = -1;
+    int64_t bestGapNs = gapNs;
+    for(auto& [eObjectId, loadNs] : busiestIter->eObjectLoadsNs)
+    {
+        if(loadNs <= 0 || mPinnedEObjectIds.count(eObjectId) > 0)
+            continue;
+        int64_t newGapNs = std::abs(gapNs - 2 * loadNs);
+        if(newGapNs < bestGapNs)
+        {
+            bestGapNs = newGapNs;
+            migratedId = eObjectId;
+        }
+    }
+    if(migratedId < 0)
+        return -1;
+    busiestIter->ethreadPtr->migrateEObject(migratedId, *idlestIter->ethreadPtr);
+    mPendingEObjectId = migratedId;
+    mPendingSourcePtr = busiestIter->ethreadPtr;
+    mNMigrations++;
+    return migratedId;
+}
+
+void ethr::ELoadBalancer::start(std::chrono::nanoseconds period)
+{
+    if(mThread.joinable())
+        return;
+    mIsStopping = false;
+    mThread = std::thread([this, period]
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while(!mStopCondition.wait_for(lock, period, [this]{ return mIsStopping; }))
+        {
+            lock.unlock();
+            rebalance();
+            lock.lock();
+        }
+    });
+}
+
+void ethr::ELoadBalancer::stop()
+{
+    if(!mThread.joinable())
+        return;
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIsStopping = true;
+    mStopCondition.notify_all();
+    lock.unlock();
+    mThread.join();
+}
@@ -0,0 +1,74 @@
+#ifndef EVENT_THREAD_EBALANCER_H
+#define EVENT_THREAD_EBALANCER_H
+
+#include "ethread.h"
+#include <algorithm>
+#include <map>
+#include <set>
+
+namespace ethr
+{
+
+/**
+ * @brief Migrates EObjects from the busiest to the idlest of a group of EThreads.
+ * The load of an EObject is its handler time since the last rebalance, plus its queued events at its mean handler time.
+ * The mean is kept across rebalances, so that an EObject waiting behind a backlog is not taken as idle.
+ */
+class ELoadBalancer
+{
+public:
+    /**
+     * @param ethreads EThreads to balance. Construct the balancer before starting them, since it enables their load tracking.
+     * Throws std::runtime_error if one of them runs without load tracking.
+     * @param threshold gap of load between the busiest and the idlest EThread to act on, as a fraction of the time since the last rebalance.
+     */
+    explicit ELoadBalancer(const std::vector<EThread*> &ethreads, const double &threshold = 0.2);
+
+    ~ELoadBalancer();
+
+    /**
+     * @brief Keep an EObject in its EThread.
+     */
+    void pin(const EObject &eObject);
+
+    /**
+     * @brief Migrate the EObject of the busiest EThread that narrows its gap to the idlest the most.
+     *
+     * @return id of the migrated EObject, or -1 if the EThreads are balanced or no EObject narrows the gap
+     */
+    int rebalance();
+
+    /**
+     * @brief Rebalance periodically in a thread of the balancer.
+     */
+    void start(std::chrono::nanoseconds period);
+
+    void stop();
+
+    size_t nMigrations() const {return mNMigrations;}
+
+private:
+    std::vector<EThread*> mEThreads;
+    double mThreshold;
+    std::mutex mMutex;      // rebalance, pinned EObjects, stop
+    std::condition_variable mStopCondition;
+    std::set<int> mPinnedEObjectIds;
+    // handler time and events of each EObject, halved on every rebalance. their ratio is a running mean of the handler time
+    struct HandleHistory
+    {
+        double handleTimeNs;
+        double nHandledEvents;
+    };
+    std::map<int, HandleHistory> mHandleHistories;
+    // the last migration, which is run by the loop of its source. no other is requested until it is run
+    int mPendingEObjectId;
+    EThread *mPendingSourcePtr;
+    std::chrono::high_resolution_clock::time_point mLastRebalanceTime;
+    std::atomic<size_t> mNMigrations;
+    bool mIsStopping;
+    std::thread mThread;
+};
+
+}
+
+#endif
@@ -0,0 +1 @@
+#include "echannel.h"
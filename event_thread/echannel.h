@@ -0,0 +1,102 @@
+#ifndef EVENT_THREAD_ECHANNEL_H
+#define EVENT_THREAD_ECHANNEL_H
+
+#include "ethread.h"
+
+namespace ethr
+{
+
+/**
+ * @brief One-to-many channel. A published message is shared among the subscribers without copies
+ * and each subscriber receives it in its own thread.
+ */
+template<typename MessageType>
+class EChannel
+{
+public:
+    using MessagePtr = std::shared_ptr<const MessageType>;
+
+    template<class EObjectType>
+    void subscribe(EObjectRef<EObjectType> eObjectRef, void(EObjectType::*funcPtr)(const MessageType&))
+    {
+        subscribe(eObjectRef, [eObjectPtr = eObjectRef.eObjectUnsafePtr(), funcPtr](const MessageType& message)
+        {
+            (eObjectPtr->*funcPtr)(message);
+        });
+    }
+
+    void subscribe(UntypedEObjectRef eObjectRef, const std::function<void(const MessageType&)> &callback)
+    {
+        if(!eObjectRef.isInitialized())
+            throw std::runtime_error("[EThread] EChannel::subscribe() is called with empty EObject reference.");
+        std::unique_lock<std::shared_mutex> lock(mMutexSubscribers);
+        mSubscribers.push_back({eObjectRef.mEObjectId, std::make_shared<const std::function<void(const MessageType&)>>(callback)});
+    }
+
+    /**
+     * @brief Remove every subscription of the EObject.
+     *
+     * @return false if the EObject was not subscribing.
+     */
+    bool unsubscribe(const UntypedEObjectRef &eObjectRef)
+    {
+        std::unique_lock<std::shared_mutex> lock(mMutexSubscribers);
+        return std::erase_if(mSubscribers, [&](const Subscriber& subscriber)
+        {
+            return subscriber.eObjectId == eObjectRef.mEObjectId;
+        }) != 0;
+    }
+
+    size_t subscriberCount()
+    {
+        std::shared_lock<std::shared_mutex> lock(mMutexSubscribers);
+        return mSubscribers.size();
+    }
+
+    size_t publish(const MessageType &message)
+    {
+        return publish(std::make_shared<const MessageType>(message));
+    }
+
+    size_t publish(MessageType &&message)
+    {
+        return publish(std::make_shared<const MessageType>(std::move(message)));
+    }
+
+    /**
+     * @brief Queue the message to every subscriber in a thread.
+     *
+     * @return number of subscribers the message is queued to.
+     */
+    size_t publish(MessagePtr messagePtr)
+    {
+        size_t nQueued = 0;
+        std::shared_lock<std::shared_mutex> subscribersLock(mMutexSubscribers);
+        std::shared_lock<std::shared_mutex> activeEObjectsLock(EObject::mutexActiveEObjectIds);
+        for(const auto& subscriber : mSubscribers)
+        {
+            auto eObjectPtrIter = EObject::activeEObjectIds.find(subscriber.eObjectId);
+            if (eObjectPtrIter == EObject::activeEObjectIds.end())
+                continue;
+            eObjectPtrIter->second->runQueued([messagePtr, callbackPtr = subscriber.callbackPtr]
+            {
+                (*callbackPtr)(*messagePtr);
+            });
+            nQueued++;
+        }
+        return nQueued;
+    }
+
+private:
+    struct Subscriber
+    {
+        int eObjectId;
+        std::shared_ptr<const std::function<void(const MessageType&)>> callbackPtr;
+    };
+    std::vector<Subscriber> mSubscribers;
+    std::shared_mutex mMutexSubscribers;
+};
+
+}
+
+#endif
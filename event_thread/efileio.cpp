@@ -0,0 +1,318 @@
+#include "efileio.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define EVENT_THREAD_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#endif
+#endif
+
+#ifdef EVENT_THREAD_IO_URING
+// rings of io_uring mapped from the kernel. the syscalls are used directly so that liburing is not required
+struct ethr::EFileIo::Ring
+{
+    int fd = -1;
+    void *sqRingPtr = MAP_FAILED;
+    size_t sqRingSize = 0;
+    void *cqRingPtr = MAP_FAILED;
+    size_t cqRingSize = 0;
+    void *sqesPtr = MAP_FAILED;
+    size_t sqesSize = 0;
+    unsigned *sqHead = nullptr;
+    unsigned *sqTail = nullptr;
+    unsigned *sqMask = nullptr;
+    unsigned *sqArray = nullptr;
+    io_uring_sqe *sqes = nullptr;
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned *cqMask = nullptr;
+    io_uring_cqe *cqes = nullptr;
+
+    ~Ring()
+    {
+        if(sqesPtr != MAP_FAILED)
+            munmap(sqesPtr, sqesSize);
+        if(cqRingPtr != MAP_FAILED && cqRingPtr != sqRingPtr)
+            munmap(cqRingPtr, cqRingSize);
+        if(sqRingPtr != MAP_FAILED)
+            munmap(sqRingPtr, sqRingSize);
+        if(fd >= 0)
+            close(fd);
+    }
+};
+#else
+struct ethr::EFileIo::Ring
+{
+};
+#endif
+
+ethr::EFileIo::EFileIo(const unsigned int &queueDepth, const unsigned int &nThreads, const bool &isIoUringAllowed)
+{
+    mBackend = Backend::THREAD_POOL;
+    mQueueDepth = std::max(queueDepth, 1u);
+    mNInFlight = 0;
+    mIsStopping = false;
+    mNextOperationId = 1;
+
+    if(isIoUringAllowed && setupRing())
+    {
+        mBackend = Backend::IO_URING;
+        mThreads.emplace_back(&EFileIo::reapRing, this);
+        return;
+    }
+    for(unsigned int i=0; i<std::max(nThreads, 1u); i++)
+        mThreads.emplace_back(&EFileIo::runIoThread, this);
+}
+
+ethr::EFileIo::~EFileIo()
+{
+    waitForCompletion();
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIsStopping = true;
+    mCondition.notify_all();
+#ifdef EVENT_THREAD_IO_URING
+    // a no-op of id 0 wakes the completion thread up to exit
+    if(mBackend == Backend::IO_URING)
+    {
+        auto& ring = *mRingPtr;
+        unsigned tail = *ring.sqTail;
+        unsigned index = tail & *ring.sqMask;
+        std::memset(&ring.sqes[index], 0, sizeof(io_uring_sqe));
+        ring.sqes[index].opcode = IORING_OP_NOP;
+        ring.sqes[index].user_data = 0;
+        ring.sqArray[index] = index;
+        __atomic_store_n(ring.sqTail, tail + 1, __ATOMIC_RELEASE);
+        syscall(__NR_io_uring_enter, ring.fd, 1, 0, 0, nullptr, 0);
+    }
+#endif
+    lock.unlock();
+
+    for(auto& thread : mThreads)
+        thread.join();
+}
+
+void ethr::EFileIo::registerBuffers(const std::vector<iovec> &buffers)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    if(mNInFlight > 0)
+        throw std::runtime_error("[EThread] EFileIo::registerBuffers() is called while operations are in flight.");
+#ifdef EVENT_THREAD_IO_URING
+    if(mBackend == Backend::IO_URING)
+    {
+        if(!mRegisteredBuffers.empty())
+            syscall(__NR_io_uring_register, mRingPtr->fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+        mRegisteredBuffers.clear();
+        if(!buffers.empty() && syscall(__NR_io_uring_register, mRingPtr->fd, IORING_REGISTER_BUFFERS, buffers.data(), buffers.size()) < 0)
+            throw std::runtime_error(std::string("[EThread] Failed to register buffers to io_uring. ") + std::strerror(errno));
+    }
+#endif
+    mRegisteredBuffers = buffers;
+}
+
+void ethr::EFileIo::read(int fd, void *data, size_t size, int64_t offset, UntypedEObjectRef ref, Callback &&callback)
+{
+    if(!ref.isInitialized())
+        throw std::runtime_error("[EThread] EFileIo::read() is called with empty EObject reference.");
+    submit({false, fd, data, size, offset, ref, std::move(callback)});
+}
+
+void ethr::EFileIo::write(int fd, const void *data, size_t size, int64_t offset, UntypedEObjectRef ref, Callback &&callback)
+{
+    if(!ref.isInitialized())
+        throw std::runtime_error("[EThread] EFileIo::write() is called with empty EObject reference.");
+    submit({true, fd, const_cast<void*>(data), size, offset, ref, std::move(callback)});
+}
+
+void ethr::EFileIo::waitForCompletion()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [&]{ return mNInFlight == 0; });
+}
+
+void ethr::EFileIo::submit(Operation &&operation)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [&]{ return mNInFlight < mQueueDepth; });
+    mNInFlight++;
+    if(mBackend == Backend::IO_URING)
+    {
+        submitToRing(std::move(operation));
+        return;
+    }
+    mPendingOperations.push_back(std::move(operation));
+    mCondition.notify_all();
+}
+
+bool ethr::EFileIo::setupRing()
+{
+#ifdef EVENT_THREAD_IO_URING
+    io_uring_params params{};
+    int fd = (int)syscall(__NR_io_uring_setup, mQueueDepth, &params);
+    if(fd < 0)
+        return false;
+    auto ringPtr = std::make_unique<Ring>();
+    ringPtr->fd = fd;
+
+    ringPtr->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ringPtr->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool isSingleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(isSingleMmap)
+        ringPtr->sqRingSize = ringPtr->cqRingSize = std::max(ringPtr->sqRingSize, ringPtr->cqRingSize);
+    ringPtr->sqRingPtr = mmap(nullptr, ringPtr->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if(ringPtr->sqRingPtr == MAP_FAILED)
+        return false;
+    ringPtr->cqRingPtr = isSingleMmap ? ringPtr->sqRingPtr :
+            mmap(nullptr, ringPtr->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if(ringPtr->cqRingPtr == MAP_FAILED)
+        return false;
+    ringPtr->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    ringPtr->sqesPtr = mmap(nullptr, ringPtr->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if(ringPtr->sqesPtr == MAP_FAILED)
+        return false;
+
+    auto* sqRing = (char*)ringPtr->sqRingPtr;
+    auto* cqRing = (char*)ringPtr->cqRingPtr;
+    ringPtr->sqHead = (unsigned*)(sqRing + params.sq_off.head);
+    ringPtr->sqTail = (unsigned*)(sqRing + params.sq_off.tail);
+    ringPtr->sqMask = (unsigned*)(sqRing + params.sq_off.ring_mask);
+    ringPtr->sqArray = (unsigned*)(sqRing + params.sq_off.array);
+    ringPtr->sqes = (io_uring_sqe*)ringPtr->sqesPtr;
+    ringPtr->cqHead = (unsigned*)(cqRing + params.cq_off.head);
+    ringPtr->cqTail = (unsigned*)(cqRing + params.cq_off.tail);
+    ringPtr->cqMask = (unsigned*)(cqRing + params.cq_off.ring_mask);
+    ringPtr->cqes = (io_uring_cqe*)(cqRing + params.cq_off.cqes);
+    mRingPtr = std::move(ringPtr);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ethr::EFileIo::submitToRing(Operation &&operation)
+{
+#ifdef EVENT_THREAD_IO_URING
+    auto& ring = *mRingPtr;
+    uint64_t id = mNextOperationId++;
+
+    // the number of operations in flight is bounded by the queue depth, so the submission queue never overflows
+    unsigned tail = *ring.sqTail;
+    unsigned index = tail & *ring.sqMask;
+    io_uring_sqe &sqe = ring.sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = operation.isWrite ? IORING_OP_WRITE : IORING_OP_READ;
+    for(size_t iBuffer=0; iBuffer<mRegisteredBuffers.size(); iBuffer++)
+    {
+        auto* base = (char*)mRegisteredBuffers[iBuffer].iov_base;
+        if((char*)operation.data >= base && (char*)operation.data + operation.size <= base + mRegisteredBuffers[iBuffer].iov_len)
+        {
+            sqe.opcode = operation.isWrite ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+            sqe.buf_index = iBuffer;
+            break;
+        }
+    }
+    sqe.fd = operation.fd;
+    sqe.addr = (uint64_t)operation.data;
+    sqe.len = (uint32_t)operation.size;
+    sqe.off = (uint64_t)operation.offset;
+    sqe.user_data = id;
+    ring.sqArray[index] = index;
+    __atomic_store_n(ring.sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    int enterResult;
+    do
+    {
+        enterResult = (int)syscall(__NR_io_uring_enter, ring.fd, 1, 0, 0, nullptr, 0);
+    } while(enterResult < 0 && errno == EINTR);
+    // an entry taken by the kernel completes through the completion queue even if the call reports an error
+    if(enterResult < 0 && __atomic_load_n(ring.sqHead, __ATOMIC_ACQUIRE) == tail)
+    {
+        // withdraw the entry so that the next submission does not pass it to the kernel with a buffer already given back
+        ssize_t result = -errno;
+        __atomic_store_n(ring.sqTail, tail, __ATOMIC_RELEASE);
+        mNInFlight--;
+        complete(operation, result);
+        mCondition.notify_all();
+        return;
+    }
+    mSubmittedOperations.emplace(id, std::move(operation));
+#endif
+}
+
+void ethr::EFileIo::reapRing()
+{
+#ifdef EVENT_THREAD_IO_URING
+    auto& ring = *mRingPtr;
+    bool isStopped = false;
+    while(!isStopped)
+    {
+        if(syscall(__NR_io_uring_enter, ring.fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0
+            && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            std::cerr<<"[EThread] Failed to wait for io_uring completions. "<<std::strerror(errno)<<std::endl;
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        unsigned head = *ring.cqHead;
+        unsigned tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+        for(; head != tail; head++)
+        {
+            const io_uring_cqe &cqe = ring.cqes[head & *ring.cqMask];
+            if(cqe.user_data == 0)
+            {
+                isStopped = true;
+                continue;
+            }
+            auto operationIter = mSubmittedOperations.find(cqe.user_data);
+            if(operationIter == mSubmittedOperations.end())
+                continue;
+            Operation operation = std::move(operationIter->second);
+            mSubmittedOperations.erase(operationIter);
+            mNInFlight--;
+            complete(operation, cqe.res);
+        }
+        __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+        mCondition.notify_all();
+    }
+#endif
+}
+
+void ethr::EFileIo::runIoThread()
+{
+    while(true)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [&]{ return mIsStopping || !mPendingOperations.empty(); });
+        if(mPendingOperations.empty())
+            return;
+        Operation operation = std::move(mPendingOperations.front());
+        mPendingOperations.pop_front();
+        lock.unlock();
+
+        ssize_t result;
+        if(operation.isWrite)
+            result = operation.offset < 0 ? ::write(operation.fd, operation.data, operation.size)
+                                          : ::pwrite(operation.fd, operation.data, operation.size, operation.offset);
+        else
+            result = operation.offset < 0 ? ::read(operation.fd, operation.data, operation.size)
+                                          : ::pread(operation.fd, operation.data, operation.size, operation.offset);
+        if(result < 0)
+            result = -errno;
+
+        lock.lock();
+        mNInFlight--;
+        complete(operation, result);
+        mCondition.notify_all();
+    }
+}
+
+void ethr::EFileIo::complete(Operation &operation, ssize_t result)
+{
+    // dropped if the EObject is not active anymore
+    operation.ref.runQueued([callback = std::move(operation.callback), result]{ callback(result); });
+}
@@ -0,0 +1,129 @@
+#ifndef EVENT_THREAD_EFILEIO_H
+#define EVENT_THREAD_EFILEIO_H
+
+#include "ethread.h"
+#include <condition_variable>
+#include <deque>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unordered_map>
+
+namespace ethr
+{
+
+/**
+ * @brief Asynchronous file reads and writes that keep blocking I/O out of event handlers.
+ * Operations are submitted to io_uring (Linux), or to a pool of I/O threads if io_uring is not available,
+ * and each completion is queued as a call to an EObject with the number of bytes transferred or -errno.
+ * The buffers must stay valid until the completion is delivered. Built on POSIX platforms only.
+ */
+class EFileIo
+{
+public:
+    enum class Backend
+    {
+        IO_URING,
+        THREAD_POOL,
+    };
+
+    using Callback = std::function<void(ssize_t)>;
+
+    /**
+     * @param queueDepth maximum number of operations in flight. submissions beyond it block.
+     * @param nThreads number of I/O threads of the thread pool backend.
+     * @param isIoUringAllowed false to use the thread pool backend.
+     */
+    explicit EFileIo(const unsigned int &queueDepth = 128, const unsigned int &nThreads = 2, const bool &isIoUringAllowed = true);
+
+    /**
+     * @brief Waits for the operations in flight.
+     */
+    ~EFileIo();
+
+    EFileIo(const EFileIo&) = delete;
+    EFileIo& operator=(const EFileIo&) = delete;
+
+    Backend backend() const {return mBackend;}
+
+    /**
+     * @brief Register buffers that are reused across operations. Operations on a registered buffer skip
+     * the page mapping of the buffer on every submission with io_uring. Call before submitting operations.
+     */
+    void registerBuffers(const std::vector<iovec> &buffers);
+
+    /**
+     * @brief Read from fd into data.
+     *
+     * @param offset file offset. -1 for the current file position.
+     */
+    void read(int fd, void *data, size_t size, int64_t offset, UntypedEObjectRef ref, Callback &&callback);
+
+    /**
+     * @brief Write data to fd.
+     *
+     * @param offset file offset. -1 for the current file position.
+     */
+    void write(int fd, const void *data, size_t size, int64_t offset, UntypedEObjectRef ref, Callback &&callback);
+
+    template<class EObjectType>
+    void read(int fd, void *data, size_t size, int64_t offset, EObjectRef<EObjectType> ref, void(EObjectType::*funcPtr)(ssize_t))
+    {
+        read(fd, data, size, offset, ref, [eObjectPtr = ref.eObjectUnsafePtr(), funcPtr](ssize_t result){ (eObjectPtr->*funcPtr)(result); });
+    }
+
+    template<class EObjectType>
+    void write(int fd, const void *data, size_t size, int64_t offset, EObjectRef<EObjectType> ref, void(EObjectType::*funcPtr)(ssize_t))
+    {
+        write(fd, data, size, offset, ref, [eObjectPtr = ref.eObjectUnsafePtr(), funcPtr](ssize_t result){ (eObjectPtr->*funcPtr)(result); });
+    }
+
+    /**
+     * @brief Block until every submitted operation has completed and its completion is queued.
+     */
+    void waitForCompletion();
+
+private:
+    struct Operation
+    {
+        bool isWrite;
+        int fd;
+        void *data;
+        size_t size;
+        int64_t offset;
+        UntypedEObjectRef ref;
+        Callback callback;
+    };
+
+    struct Ring;
+
+    Backend mBackend;
+    unsigned int mQueueDepth;
+    std::mutex mMutex;
+    std::condition_variable mCondition;     // notified on completion and on submission to the thread pool
+    size_t mNInFlight;
+    bool mIsStopping;
+    std::vector<iovec> mRegisteredBuffers;
+    std::vector<std::thread> mThreads;      // io_uring completion thread or the I/O threads
+    // io_uring backend
+    std::unique_ptr<Ring> mRingPtr;
+    std::unordered_map<uint64_t, Operation> mSubmittedOperations;
+    uint64_t mNextOperationId;
+    // thread pool backend
+    std::deque<Operation> mPendingOperations;
+
+    void submit(Operation &&operation);
+
+    bool setupRing();
+
+    void submitToRing(Operation &&operation);
+
+    void reapRing();
+
+    void runIoThread();
+
+    void complete(Operation &operation, ssize_t result);
+};
+
+}
+
+#endif
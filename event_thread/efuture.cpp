@@ -0,0 +1 @@
+#include "efuture.h"
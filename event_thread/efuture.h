@@ -0,0 +1,180 @@
+#ifndef EVENT_THREAD_EFUTURE_H
+#define EVENT_THREAD_EFUTURE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+
+namespace ethr
+{
+template <class>
+class EObjectRef;
+
+/**
+ * @brief Result of a call queued with EObjectRef::callAsync().
+ * Fulfilled by the target EThread right after the handler returns. Waiting blocks on a futex instead of polling.
+ */
+template<typename ValueType>
+class EFuture
+{
+public:
+    EFuture() = default;
+
+    /**
+     * @brief Check if the future refers to a call.
+     */
+    bool isValid() const
+    {
+        return mStatePtr != nullptr;
+    }
+
+    bool isReady() const
+    {
+        if(!mStatePtr)
+            throw std::runtime_error("[EThread] EFuture::isReady() is called on an empty future.");
+        return mStatePtr->readyFlag.load(std::memory_order_acquire) != 0;
+    }
+
+    /**
+     * @brief Block until the call is handled.
+     */
+    void wait() const
+    {
+        if(!mStatePtr)
+            throw std::runtime_error("[EThread] EFuture::wait() is called on an empty future.");
+        while(mStatePtr->readyFlag.load(std::memory_order_acquire) == 0)
+            mStatePtr->readyFlag.wait(0, std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Block until the call is handled or the timeout passes. A call to a stopped EThread stays queued
+     * until the EThread is started again, so use this to bound the wait.
+     *
+     * @return false on timeout
+     */
+    bool waitFor(const std::chrono::nanoseconds &timeout) const
+    {
+        if(!mStatePtr)
+            throw std::runtime_error("[EThread] EFuture::waitFor() is called on an empty future.");
+        State &state = *mStatePtr;
+        if(state.readyFlag.load(std::memory_order_acquire) != 0)
+            return true;
+        // std::atomic::wait() has no timeout. the resolver notifies the condition only while a timed waiter is announced
+        state.nTimedWaiters.fetch_add(1, std::memory_order_seq_cst);
+        std::unique_lock<std::mutex> lock(state.mutexTimedWait);
+        bool isReady = state.conditionTimedWait.wait_for(lock, timeout, [&]
+        {
+            return state.readyFlag.load(std::memory_order_seq_cst) != 0;
+        });
+        lock.unlock();
+        state.nTimedWaiters.fetch_sub(1, std::memory_order_relaxed);
+        return isReady;
+    }
+
+    /**
+     * @brief Block until the call is handled and take its result. Rethrows the exception thrown by the handler,
+     * or throws std::runtime_error if the call was dropped. Can be called once.
+     */
+    ValueType get()
+    {
+        wait();
+        auto statePtr = std::move(mStatePtr);
+        if(statePtr->exception)
+            std::rethrow_exception(statePtr->exception);
+        if constexpr(!std::is_void_v<ValueType>)
+            return std::move(*statePtr->value);
+    }
+
+private:
+    using StorageType = std::conditional_t<std::is_void_v<ValueType>, char, ValueType>;
+
+    struct State
+    {
+        std::atomic<uint32_t> readyFlag{0};
+        std::optional<StorageType> value;
+        std::exception_ptr exception;
+        std::atomic<uint32_t> nTimedWaiters{0};
+        std::mutex mutexTimedWait;
+        std::condition_variable conditionTimedWait;
+    };
+
+    // fulfills the state once. breaks it if destroyed unfulfilled, which happens when the queued call is dropped
+    class Resolver
+    {
+    public:
+        explicit Resolver(std::shared_ptr<State> statePtr) : mStatePtr(std::move(statePtr)){}
+
+        Resolver(const Resolver&) = delete;
+        Resolver& operator=(const Resolver&) = delete;
+
+        ~Resolver()
+        {
+            if(mStatePtr)
+                setException(std::make_exception_ptr(std::runtime_error("[EThread] The call of EFuture is dropped before handled.")));
+        }
+
+        template<typename Func>
+        void run(Func &&func)
+        {
+            try
+            {
+                if constexpr(std::is_void_v<ValueType>)
+                {
+                    func();
+                    mStatePtr->value.emplace();
+                }
+                else
+                {
+                    mStatePtr->value.emplace(func());
+                }
+            }
+            catch(...)
+            {
+                mStatePtr->exception = std::current_exception();
+            }
+            setReady();
+        }
+
+    private:
+        void setException(std::exception_ptr exception)
+        {
+            mStatePtr->exception = std::move(exception);
+            setReady();
+        }
+
+        void setReady()
+        {
+            auto statePtr = std::move(mStatePtr);
+            statePtr->readyFlag.store(1, std::memory_order_seq_cst);
+            statePtr->readyFlag.notify_all();
+            if(statePtr->nTimedWaiters.load(std::memory_order_seq_cst) != 0)
+            {
+                std::unique_lock<std::mutex> lock(statePtr->mutexTimedWait);
+                statePtr->conditionTimedWait.notify_all();
+            }
+        }
+
+        std::shared_ptr<State> mStatePtr;
+    };
+
+    explicit EFuture(std::shared_ptr<State> statePtr) : mStatePtr(std::move(statePtr)){}
+
+    static std::pair<EFuture, std::shared_ptr<Resolver>> create()
+    {
+        auto statePtr = std::make_shared<State>();
+        return {EFuture(statePtr), std::make_shared<Resolver>(statePtr)};
+    }
+
+    std::shared_ptr<State> mStatePtr;
+
+    template <class> friend class EObjectRef;
+};
+}
+
+#endif
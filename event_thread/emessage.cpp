@@ -0,0 +1 @@
+#include "emessage.h"
@@ -0,0 +1,124 @@
+#ifndef EVENT_THREAD_EMESSAGE_H
+#define EVENT_THREAD_EMESSAGE_H
+
+#include "ethread.h"
+#include <variant>
+
+namespace ethr
+{
+
+/**
+ * @brief EObject that receives a closed set of message types instead of type-erased calls.
+ * Messages are stored inline in a std::variant queue, drained by a single event per batch
+ * and dispatched with std::visit to Derived::onMessage(MessageType&), so posting needs no std::bind nor per-message allocation.
+ *
+ * @code
+ * class Motor : public EMessageObject<Motor, SetSpeed, Stop>
+ * {
+ * public:
+ *     void onMessage(SetSpeed &message);
+ *     void onMessage(Stop &message);
+ * };
+ * @endcode
+ */
+template<class Derived, typename... MessageTypes>
+class EMessageObject : public EObject
+{
+public:
+    using Message = std::variant<MessageTypes...>;
+
+    EMessageObject() : mStatePtr(std::make_shared<State>()){}
+
+    /**
+     * @brief Queue a message to be handled in the thread of this EObject. Can be called from any thread.
+     *
+     * @return false if the message queue is full
+     */
+    template<typename MessageType>
+    bool post(MessageType &&message)
+    {
+        EThread *ethreadPtr = threadInAffinity();
+        if(ethreadPtr == nullptr)
+            throw std::runtime_error("[EThread] EMessageObject::post() is called but no EThread is assigned to it.");
+        uint64_t generation = affinityGeneration();
+        State &state = *mStatePtr;
+        std::unique_lock<std::mutex> lock(state.mutex);
+        if(state.messages.size() >= state.messageQueueSize)
+            return false;
+        state.messages.emplace_back(std::in_place_type<std::decay_t<MessageType>>, std::forward<MessageType>(message));
+        // a drain queued before the EObject was moved is dropped with the events of the previous thread
+        if(state.isDrainQueued && state.drainGeneration == generation)
+            return true;
+        state.isDrainQueued = true;
+        state.drainGeneration = generation;
+        lock.unlock();
+
+        auto ticketPtr = std::make_shared<DrainTicket>(mStatePtr, static_cast<Derived*>(this), generation);
+        runQueued([ticketPtr]{ ticketPtr->drain(); });
+        return true;
+    }
+
+    /**
+     * @brief Set the maximum number of messages waiting to be handled.
+     */
+    void setMessageQueueSize(const size_t &size)
+    {
+        std::unique_lock<std::mutex> lock(mStatePtr->mutex);
+        mStatePtr->messageQueueSize = size;
+    }
+
+private:
+    struct State
+    {
+        std::mutex mutex;
+        std::vector<Message> messages;
+        std::vector<Message> spareMessages;     // buffer of the last drain, reused to avoid reallocation
+        size_t messageQueueSize = 65536;
+        bool isDrainQueued = false;
+        uint64_t drainGeneration = 0;
+    };
+
+    // owned by the queued drain event. a drain dropped with the event, such as when the event queue is full,
+    // releases the queued flag so that the next post queues a new one
+    struct DrainTicket
+    {
+        DrainTicket(std::shared_ptr<State> statePtr, Derived *derivedPtr, uint64_t generation)
+            : statePtr(std::move(statePtr)), derivedPtr(derivedPtr), generation(generation){}
+
+        ~DrainTicket()
+        {
+            std::unique_lock<std::mutex> lock(statePtr->mutex);
+            if(statePtr->drainGeneration == generation)
+                statePtr->isDrainQueued = false;
+        }
+
+        void drain()
+        {
+            std::unique_lock<std::mutex> lock(statePtr->mutex);
+            // messages posted from here on queue another drain
+            statePtr->isDrainQueued = false;
+            std::vector<Message> messages;
+            messages.swap(statePtr->spareMessages);
+            messages.swap(statePtr->messages);
+            lock.unlock();
+
+            for(auto &message : messages)
+                std::visit([this](auto &typedMessage){ derivedPtr->onMessage(typedMessage); }, message);
+
+            messages.clear();
+            lock.lock();
+            if(messages.capacity() > statePtr->spareMessages.capacity())
+                statePtr->spareMessages.swap(messages);
+        }
+
+        std::shared_ptr<State> statePtr;
+        Derived *derivedPtr;
+        uint64_t generation;
+    };
+
+    std::shared_ptr<State> mStatePtr;
+};
+
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include "emetrics.h"
+#include <bit>
+#include <algorithm>
+
+namespace
+{
+// single writer increment. cheaper than fetch_add and still safe to read from other threads
+template<typename T>
+void add(std::atomic<T> &counter, const T &value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+}
+
+ethr::ELatencyHistogram::Snapshot::Snapshot()
+{
+    mCounts.fill(0);
+    mCount = 0;
+    mSum = 0;
+    mMax = 0;
+}
+
+std::chrono::nanoseconds ethr::ELatencyHistogram::Snapshot::mean() const
+{
+    if(mCount == 0)
+        return std::chrono::nanoseconds(0);
+    return std::chrono::nanoseconds(mSum / mCount);
+}
+
+std::chrono::nanoseconds ethr::ELatencyHistogram::Snapshot::percentile(const double &percent) const
+{
+    if(mCount == 0)
+        return std::chrono::nanoseconds(0);
+    auto rank = (uint64_t)(percent / 100.0 * (double)mCount + 0.5);
+    if(rank == 0)
+        rank = 1;
+    uint64_t nCounted = 0;
+    for(int i=0; i<N_BUCKETS; i++)
+    {
+        nCounted += mCounts[i];
+        if(nCounted >= rank)
+            return std::chrono::nanoseconds(std::min<uint64_t>(bucketUpperBound(i), mMax));
+    }
+    return max();
+}
+
+ethr::ELatencyHistogram::ELatencyHistogram()
+{
+    reset();
+}
+
+int ethr::ELatencyHistogram::bucketIndex(const uint64_t &ns)
+{
+    if(ns < N_SUB_BUCKETS)
+        return (int)ns;
+    int msb = 63 - std::countl_zero(ns);
+    int shift = msb - SUB_BUCKET_BITS;
+    return ((shift + 1) << SUB_BUCKET_BITS) | (int)((ns >> shift) & (N_SUB_BUCKETS - 1));
+}
+
+uint64_t ethr::ELatencyHistogram::bucketLowerBound(const int &index)
+{
+    if(index < N_SUB_BUCKETS)
+        return index;
+    int shift = (index >> SUB_BUCKET_BITS) - 1;
+    return ((uint64_t)N_SUB_BUCKETS | (uint64_t)(index & (N_SUB_BUCKETS - 1))) << shift;
+}
+
+uint64_t ethr::ELatencyHistogram::bucketUpperBound(const int &index)
+{
+    if(index < N_SUB_BUCKETS)
+        return index;
+    int shift = (index >> SUB_BUCKET_BITS) - 1;
+    return bucketLowerBound(index) + (((uint64_t)1 << shift) - 1);
+}
+
+void ethr::ELatencyHistogram::record(const std::chrono::nanoseconds &latency)
+{
+    auto ns = (uint64_t)std::max<int64_t>(latency.count(), 0);
+    add<uint64_t>(mCounts[bucketIndex(ns)], 1);
+    add<uint64_t>(mSum, ns);
+    if((int64_t)ns > mMax.load(std::memory_order_relaxed))
+        mMax.store((int64_t)ns, std::memory_order_relaxed);
+}
+
+ethr::ELatencyHistogram::Snapshot ethr::ELatencyHistogram::snapshot() const
+{
+    Snapshot snapshot;
+    for(int i=0; i<N_BUCKETS; i++)
+    {
+        snapshot.mCounts[i] = mCounts[i].load(std::memory_order_relaxed);
+        snapshot.mCount += snapshot.mCounts[i];
+    }
+    snapshot.mSum = mSum.load(std::memory_order_relaxed);
+    snapshot.mMax = mMax.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+void ethr::ELatencyHistogram::reset()
+{
+    for(auto & count : mCounts)
+        count.store(0, std::memory_order_relaxed);
+    mSum.store(0, std::memory_order_relaxed);
+    mMax.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,61 @@
+#ifndef EVENT_THREAD_EMETRICS_H
+#define EVENT_THREAD_EMETRICS_H
+
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace ethr
+{
+
+/**
+ * @brief Latency histogram with log-linear buckets of nanoseconds (HDR style, 12.5% resolution).
+ * Recording is lock-free and meant for a single writer thread. Snapshots can be taken from any thread.
+ */
+class ELatencyHistogram
+{
+public:
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr int N_SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int N_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * N_SUB_BUCKETS;
+
+    class Snapshot
+    {
+    public:
+        Snapshot();
+        uint64_t count() const {return mCount;}
+        std::chrono::nanoseconds max() const {return std::chrono::nanoseconds(mMax);}
+        std::chrono::nanoseconds mean() const;
+        /**
+         * @brief Get the latency at a percentile.
+         *
+         * @param percent 0 to 100. e.g. 99.9 for p999
+         */
+        std::chrono::nanoseconds percentile(const double &percent) const;
+    private:
+        std::array<uint64_t, N_BUCKETS> mCounts;
+        uint64_t mCount;
+        uint64_t mSum;
+        int64_t mMax;
+        friend ELatencyHistogram;
+    };
+
+    ELatencyHistogram();
+    void record(const std::chrono::nanoseconds &latency);
+    Snapshot snapshot() const;
+    void reset();
+
+    static int bucketIndex(const uint64_t &ns);
+    static uint64_t bucketLowerBound(const int &index);
+    static uint64_t bucketUpperBound(const int &index);
+
+private:
+    std::array<std::atomic<uint64_t>, N_BUCKETS> mCounts;
+    std::atomic<uint64_t> mSum;
+    std::atomic<int64_t> mMax;
+};
+
+}
+
+#endif
@@ -0,0 +1 @@
+#include "epipe.h"
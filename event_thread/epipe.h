@@ -0,0 +1,127 @@
+#ifndef EVENT_THREAD_EPIPE_H
+#define EVENT_THREAD_EPIPE_H
+
+#include "ethread.h"
+#include <atomic>
+#include <optional>
+
+namespace ethr
+{
+
+/**
+ * @brief Single-producer single-consumer pipe that streams items to an EObject.
+ * Items are moved into preallocated slots of a lock-free ring buffer, and the consumer drains them in its thread.
+ * Only one thread may push at a time.
+ */
+template<typename ItemType>
+class EPipe
+{
+public:
+    template<class EObjectType>
+    EPipe(EObjectRef<EObjectType> consumerRef, void(EObjectType::*funcPtr)(ItemType&&), const size_t &capacity = 1024)
+    : EPipe(consumerRef, [eObjectPtr = consumerRef.eObjectUnsafePtr(), funcPtr](ItemType&& item)
+    {
+        (eObjectPtr->*funcPtr)(std::move(item));
+    }, capacity){}
+
+    EPipe(UntypedEObjectRef consumerRef, const std::function<void(ItemType&&)> &callback, const size_t &capacity = 1024)
+    {
+        if(!consumerRef.isInitialized())
+            throw std::runtime_error("[EThread] EPipe is created using empty EObject reference.");
+        if(capacity == 0)
+            throw std::runtime_error("[EThread] EPipe is created with zero capacity.");
+        size_t roundedCapacity = 1;
+        while(roundedCapacity < capacity)
+            roundedCapacity <<= 1;
+        mConsumerRef = consumerRef;
+        mStatePtr = std::make_shared<State>(roundedCapacity, callback);
+    }
+
+    /**
+     * @brief Push an item to the pipe.
+     *
+     * @return false if the pipe is full. The item is left untouched in that case.
+     */
+    bool push(ItemType &&item)
+    {
+        State &state = *mStatePtr;
+        size_t tail = state.tail.load(std::memory_order_relaxed);
+        if(tail - state.head.load(std::memory_order_acquire) == state.slots.size())
+            return false;
+        state.slots[tail & state.mask].emplace(std::move(item));
+        state.tail.store(tail + 1, std::memory_order_seq_cst);
+
+        // queue a drain only when the consumer is not already notified
+        if(!state.isDrainQueued.exchange(true, std::memory_order_seq_cst))
+        {
+            auto ticketPtr = std::make_shared<DrainTicket>(mStatePtr);
+            mConsumerRef.runQueued([ticketPtr]{ ticketPtr->drain(); });
+        }
+        return true;
+    }
+
+    bool push(const ItemType &item)
+    {
+        ItemType copied(item);
+        return push(std::move(copied));
+    }
+
+    size_t capacity() const {return mStatePtr->slots.size();}
+
+private:
+    struct State
+    {
+        State(const size_t &capacity, const std::function<void(ItemType&&)> &callback)
+        : slots(capacity), mask(capacity - 1), callback(callback), head(0), tail(0), isDrainQueued(false){}
+
+        void drain()
+        {
+            // clearing the flag before reading tail makes the producer queue another drain for items missed here
+            isDrainQueued.store(false, std::memory_order_seq_cst);
+            size_t tailSnapshot = tail.load(std::memory_order_seq_cst);
+            for(size_t iHead = head.load(std::memory_order_relaxed); iHead != tailSnapshot; iHead++)
+            {
+                ItemType item = std::move(*slots[iHead & mask]);
+                slots[iHead & mask].reset();
+                head.store(iHead + 1, std::memory_order_release);
+                callback(std::move(item));
+            }
+        }
+
+        std::vector<std::optional<ItemType>> slots;
+        const size_t mask;
+        const std::function<void(ItemType&&)> callback;
+        alignas(64) std::atomic<size_t> head;  // written by consumer
+        alignas(64) std::atomic<size_t> tail;  // written by producer
+        std::atomic<bool> isDrainQueued;
+    };
+
+    // owned by the queued drain event. a drain dropped with the event, such as when the event queue is full
+    // or the consumer has moved, releases the queued flag so that the next push queues a new one
+    struct DrainTicket
+    {
+        explicit DrainTicket(std::shared_ptr<State> statePtr) : statePtr(std::move(statePtr)), isDrained(false){}
+
+        ~DrainTicket()
+        {
+            if(!isDrained)
+                statePtr->isDrainQueued.store(false, std::memory_order_seq_cst);
+        }
+
+        void drain()
+        {
+            isDrained = true;
+            statePtr->drain();
+        }
+
+        std::shared_ptr<State> statePtr;
+        bool isDrained;
+    };
+
+    UntypedEObjectRef mConsumerRef;
+    std::shared_ptr<State> mStatePtr;
+};
+
+}
+
+#endif
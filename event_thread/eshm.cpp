@@ -0,0 +1,299 @@
+#include "eshm.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+constexpr uint64_t SEGMENT_MAGIC = 0x4553484d51554555;  // "ESHMQUEU"
+constexpr size_t CACHE_LINE_SIZE = 64;
+}
+
+struct ethr::EShmQueue::Header
+{
+    std::atomic<uint64_t> magic;    // written last by the creator
+    uint64_t capacity;
+    uint64_t slotSize;
+    uint64_t slotStride;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> enqueuePosition;    // producers
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> dequeuePosition;    // consumer
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> signal;             // futex word, bumped to wake the consumer up
+    std::atomic<uint32_t> isConsumerWaiting;
+};
+
+// slot of a bounded MPMC ring (Vyukov). the sequence tells whether the slot is free or written for a position
+struct ethr::EShmQueue::SlotHeader
+{
+    std::atomic<uint64_t> sequence;
+    uint32_t messageId;
+    uint32_t size;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "EShmQueue requires address-free atomics");
+
+ethr::EShmQueue::EShmQueue(const std::string &name, bool isOwner)
+{
+    mName = name;
+    mIsOwner = isOwner;
+    mSegmentPtr = MAP_FAILED;
+    mSegmentSize = 0;
+    mHeaderPtr = nullptr;
+}
+
+ethr::EShmQueue::~EShmQueue()
+{
+    if(mSegmentPtr != MAP_FAILED)
+        munmap(mSegmentPtr, mSegmentSize);
+    if(mIsOwner)
+        shm_unlink(mName.c_str());
+}
+
+std::unique_ptr<ethr::EShmQueue> ethr::EShmQueue::create(const std::string &name, const size_t &capacity, const size_t &slotSize)
+{
+    if(capacity == 0)
+        throw std::runtime_error("[EThread] EShmQueue is created with zero capacity.");
+    size_t roundedCapacity = 1;
+    while(roundedCapacity < capacity)
+        roundedCapacity <<= 1;
+    size_t slotStride = (sizeof(SlotHeader) + slotSize + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    size_t headerSize = (sizeof(Header) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+
+    std::unique_ptr<EShmQueue> queuePtr(new EShmQueue(name, true));
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if(fd < 0)
+        throw std::runtime_error("[EThread] Failed to create shared memory " + name + ". " + std::strerror(errno));
+    queuePtr->mSegmentSize = headerSize + roundedCapacity * slotStride;
+    if(ftruncate(fd, (off_t)queuePtr->mSegmentSize) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("[EThread] Failed to size shared memory " + name + ". " + std::strerror(errno));
+    }
+    queuePtr->mSegmentPtr = mmap(nullptr, queuePtr->mSegmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(queuePtr->mSegmentPtr == MAP_FAILED)
+        throw std::runtime_error("[EThread] Failed to map shared memory " + name + ". " + std::strerror(errno));
+
+    auto* headerPtr = new(queuePtr->mSegmentPtr) Header();
+    headerPtr->capacity = roundedCapacity;
+    headerPtr->slotSize = slotSize;
+    headerPtr->slotStride = slotStride;
+    headerPtr->enqueuePosition = 0;
+    headerPtr->dequeuePosition = 0;
+    headerPtr->signal = 0;
+    headerPtr->isConsumerWaiting = 0;
+    queuePtr->mHeaderPtr = headerPtr;
+    for(uint64_t i=0; i<roundedCapacity; i++)
+        new(queuePtr->slot(i)) SlotHeader{{i}, 0, 0};
+    headerPtr->magic.store(SEGMENT_MAGIC, std::memory_order_release);
+    return queuePtr;
+}
+
+std::unique_ptr<ethr::EShmQueue> ethr::EShmQueue::open(const std::string &name)
+{
+    std::unique_ptr<EShmQueue> queuePtr(new EShmQueue(name, false));
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if(fd < 0)
+        throw std::runtime_error("[EThread] Failed to open shared memory " + name + ". " + std::strerror(errno));
+    struct stat fileStat{};
+    if(fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(Header))
+    {
+        close(fd);
+        throw std::runtime_error("[EThread] Shared memory " + name + " is not an EShmQueue.");
+    }
+    queuePtr->mSegmentSize = (size_t)fileStat.st_size;
+    queuePtr->mSegmentPtr = mmap(nullptr, queuePtr->mSegmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(queuePtr->mSegmentPtr == MAP_FAILED)
+        throw std::runtime_error("[EThread] Failed to map shared memory " + name + ". " + std::strerror(errno));
+    queuePtr->mHeaderPtr = (Header*)queuePtr->mSegmentPtr;
+    if(queuePtr->mHeaderPtr->magic.load(std::memory_order_acquire) != SEGMENT_MAGIC)
+        throw std::runtime_error("[EThread] Shared memory " + name + " is not an EShmQueue.");
+    return queuePtr;
+}
+
+ethr::EShmQueue::SlotHeader *ethr::EShmQueue::slot(uint64_t position) const
+{
+    size_t headerSize = (sizeof(Header) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    return (SlotHeader*)((char*)mSegmentPtr + headerSize + (position & (mHeaderPtr->capacity - 1)) * mHeaderPtr->slotStride);
+}
+
+size_t ethr::EShmQueue::slotSize() const
+{
+    return mHeaderPtr->slotSize;
+}
+
+char *ethr::EShmQueue::beginPush(uint32_t messageId, size_t size, uint64_t &position)
+{
+    position = mHeaderPtr->enqueuePosition.load(std::memory_order_relaxed);
+    SlotHeader *slotPtr;
+    while(true)
+    {
+        slotPtr = slot(position);
+        auto difference = (int64_t)(slotPtr->sequence.load(std::memory_order_acquire) - position);
+        if(difference == 0)
+        {
+            if(mHeaderPtr->enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(difference < 0)
+        {
+            return nullptr;
+        }
+        else
+        {
+            position = mHeaderPtr->enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+    slotPtr->messageId = messageId;
+    slotPtr->size = (uint32_t)size;
+    return (char*)slotPtr + sizeof(SlotHeader);
+}
+
+void ethr::EShmQueue::commitPush(uint64_t position)
+{
+    slot(position)->sequence.store(position + 1, std::memory_order_seq_cst);
+
+    // only the first producer after the consumer went to sleep makes the syscall
+    if(mHeaderPtr->isConsumerWaiting.load(std::memory_order_seq_cst) && mHeaderPtr->isConsumerWaiting.exchange(0))
+        wake();
+}
+
+const char *ethr::EShmQueue::front(uint32_t &messageId, size_t &size)
+{
+    uint64_t position = mHeaderPtr->dequeuePosition.load(std::memory_order_relaxed);
+    SlotHeader *slotPtr = slot(position);
+    if(slotPtr->sequence.load(std::memory_order_acquire) != position + 1)
+        return nullptr;
+    messageId = slotPtr->messageId;
+    size = slotPtr->size;
+    return (char*)slotPtr + sizeof(SlotHeader);
+}
+
+void ethr::EShmQueue::pop()
+{
+    uint64_t position = mHeaderPtr->dequeuePosition.load(std::memory_order_relaxed);
+    slot(position)->sequence.store(position + mHeaderPtr->capacity, std::memory_order_release);
+    mHeaderPtr->dequeuePosition.store(position + 1, std::memory_order_relaxed);
+}
+
+bool ethr::EShmQueue::empty() const
+{
+    uint64_t position = mHeaderPtr->dequeuePosition.load(std::memory_order_relaxed);
+    return slot(position)->sequence.load(std::memory_order_seq_cst) != position + 1;
+}
+
+uint32_t ethr::EShmQueue::prepareWait()
+{
+    mHeaderPtr->isConsumerWaiting.store(1, std::memory_order_seq_cst);
+    return mHeaderPtr->signal.load(std::memory_order_seq_cst);
+}
+
+void ethr::EShmQueue::wait(uint32_t token)
+{
+#ifdef __linux__
+    // not a private futex, so that producers in other processes can wake it
+    syscall(SYS_futex, (uint32_t*)&mHeaderPtr->signal, FUTEX_WAIT, token, nullptr, nullptr, 0);
+#else
+    while(mHeaderPtr->signal.load(std::memory_order_seq_cst) == token)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+#endif
+}
+
+void ethr::EShmQueue::wake()
+{
+    mHeaderPtr->signal.fetch_add(1, std::memory_order_seq_cst);
+#ifdef __linux__
+    syscall(SYS_futex, (uint32_t*)&mHeaderPtr->signal, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#endif
+}
+
+ethr::EShmReceiver::EShmReceiver(const std::string &name, UntypedEObjectRef ref, const size_t &capacity, const size_t &slotSize)
+{
+    if(!ref.isInitialized())
+        throw std::runtime_error("[EThread] EShmReceiver is created using empty EObject reference.");
+    mName = name;
+    mCapacity = capacity;
+    mSlotSize = slotSize;
+    mRef = ref;
+    mStatePtr = std::make_shared<State>();
+}
+
+void ethr::EShmReceiver::start()
+{
+    if(mWaitThread.joinable())
+        return;
+    mStatePtr->queuePtr = EShmQueue::create(mName, mCapacity, mSlotSize);
+    mWaitThread = std::thread(&EShmReceiver::runWaitThread, this);
+}
+
+ethr::EShmReceiver::~EShmReceiver()
+{
+    if(!mWaitThread.joinable())
+        return;
+    mStatePtr->isStopping = true;
+    mStatePtr->queuePtr->wake();
+    mWaitThread.join();
+}
+
+void ethr::EShmReceiver::runWaitThread()
+{
+    auto& queue = *mStatePtr->queuePtr;
+    while(!mStatePtr->isStopping)
+    {
+        uint32_t token = queue.prepareWait();
+        // the drain handles every message pushed before it finds the queue empty,
+        // and the ones pushed after that wake this thread up since it is announced to wait
+        if(!queue.empty() && !mStatePtr->isDrainQueued.exchange(true))
+        {
+            uint64_t nDroppedDrains = mStatePtr->nDroppedDrains.load();
+            auto ticketPtr = std::make_shared<DrainTicket>(mStatePtr);
+            mRef.runQueued([ticketPtr]{ ticketPtr->drain(); });
+            ticketPtr.reset();
+            // dropped right away, the event queue is full or the EObject is gone. retry later instead of spinning
+            if(mStatePtr->nDroppedDrains.load() != nDroppedDrains)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if(mStatePtr->isStopping)
+            break;
+        queue.wait(token);
+    }
+}
+
+ethr::EShmReceiver::DrainTicket::~DrainTicket()
+{
+    if(isDrained)
+        return;
+    statePtr->isDrainQueued.store(false, std::memory_order_seq_cst);
+    statePtr->nDroppedDrains.fetch_add(1);
+    statePtr->queuePtr->wake();
+}
+
+void ethr::EShmReceiver::DrainTicket::drain()
+{
+    isDrained = true;
+    statePtr->drain();
+}
+
+void ethr::EShmReceiver::State::drain()
+{
+    isDrainQueued.store(false, std::memory_order_seq_cst);
+    uint32_t messageId;
+    size_t size;
+    while(const char *data = queuePtr->front(messageId, size))
+    {
+        auto handlerIter = handlers.find(messageId);
+        if(handlerIter != handlers.end())
+            handlerIter->second(data, size);
+        else
+            std::cerr<<"[EThread] EShmReceiver("<<queuePtr->name()<<") has no handler for message "<<messageId<<"."<<std::endl;
+        queuePtr->pop();
+    }
+}
@@ -0,0 +1,219 @@
+#ifndef EVENT_THREAD_ESHM_H
+#define EVENT_THREAD_ESHM_H
+
+#include "ethread.h"
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+
+namespace ethr
+{
+
+/**
+ * @brief Serialization of a payload posted through EShmProxy. Trivially copyable types are copied as they are.
+ * Specialize it for other types with size(), encode() and decode().
+ */
+template<typename T, typename = void>
+struct EShmCodec;
+
+template<typename T>
+struct EShmCodec<T, std::enable_if_t<std::is_trivially_copyable_v<T>>>
+{
+    static size_t size(const T &value){return sizeof(T);}
+    static void encode(const T &value, char *data){std::memcpy(data, &value, sizeof(T));}
+    static T decode(const char *data, size_t size)
+    {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+};
+
+template<>
+struct EShmCodec<std::string>
+{
+    static size_t size(const std::string &value){return value.size();}
+    static void encode(const std::string &value, char *data){std::memcpy(data, value.data(), value.size());}
+    static std::string decode(const char *data, size_t size){return {data, size};}
+};
+
+/**
+ * @brief Bounded lock-free multi-producer single-consumer ring of messages in a POSIX shared memory segment.
+ * Producers may live in any process that opens the segment. Linux only.
+ */
+class EShmQueue
+{
+public:
+    /**
+     * @brief Create a segment. A segment left with the same name is replaced.
+     *
+     * @param name shared memory name such as "/my_queue"
+     * @param capacity number of slots. rounded up to a power of 2.
+     * @param slotSize maximum payload size of a message.
+     */
+    static std::unique_ptr<EShmQueue> create(const std::string &name, const size_t &capacity, const size_t &slotSize);
+
+    /**
+     * @brief Open a segment created by another process.
+     */
+    static std::unique_ptr<EShmQueue> open(const std::string &name);
+
+    ~EShmQueue();
+
+    EShmQueue(const EShmQueue&) = delete;
+    EShmQueue& operator=(const EShmQueue&) = delete;
+
+    /**
+     * @brief Reserve a slot for a message and get its payload buffer. Returns nullptr if the queue is full.
+     * The message is visible to the consumer on commitPush().
+     */
+    char* beginPush(uint32_t messageId, size_t size, uint64_t &position);
+
+    void commitPush(uint64_t position);
+
+    /**
+     * @brief Get the oldest message, or nullptr if there is none. Consumer only.
+     */
+    const char* front(uint32_t &messageId, size_t &size);
+
+    void pop();
+
+    bool empty() const;
+
+    /**
+     * @brief Announce that the consumer is going to wait. Messages pushed from now on end wait() with the returned token.
+     */
+    uint32_t prepareWait();
+
+    /**
+     * @brief Block until a message is pushed or wake() is called after prepareWait(). Consumer only.
+     */
+    void wait(uint32_t token);
+
+    void wake();
+
+    size_t slotSize() const;
+
+    const std::string& name() const {return mName;}
+
+private:
+    struct Header;
+    struct SlotHeader;
+
+    EShmQueue(const std::string &name, bool isOwner);
+
+    SlotHeader* slot(uint64_t position) const;
+
+    std::string mName;
+    bool mIsOwner;
+    void *mSegmentPtr;
+    size_t mSegmentSize;
+    Header *mHeaderPtr;
+};
+
+/**
+ * @brief Receiving end of an EShmQueue. Messages are dispatched to handlers in the thread of an EObject.
+ * Register the handlers, then start() to create the queue.
+ */
+class EShmReceiver
+{
+public:
+    EShmReceiver(const std::string &name, UntypedEObjectRef ref, const size_t &capacity = 1024, const size_t &slotSize = 256);
+
+    ~EShmReceiver();
+
+    /**
+     * @brief Create the shared memory queue and start receiving.
+     */
+    void start();
+
+    /**
+     * @brief Register the handler of a message id. Called before start().
+     */
+    template<typename T>
+    void handle(uint32_t messageId, std::function<void(T&&)> &&handler)
+    {
+        if(mWaitThread.joinable())
+            throw std::runtime_error("[EThread] EShmReceiver::handle() is called after start().");
+        mStatePtr->handlers[messageId] = [handler = std::move(handler)](const char *data, size_t size)
+        {
+            handler(EShmCodec<T>::decode(data, size));
+        };
+    }
+
+    template<typename T, class EObjectType>
+    void handle(uint32_t messageId, EObjectRef<EObjectType> ref, void(EObjectType::*funcPtr)(T&&))
+    {
+        handle<T>(messageId, [eObjectPtr = ref.eObjectUnsafePtr(), funcPtr](T &&value){ (eObjectPtr->*funcPtr)(std::move(value)); });
+    }
+
+private:
+    struct State
+    {
+        std::unique_ptr<EShmQueue> queuePtr;
+        std::unordered_map<uint32_t, std::function<void(const char*, size_t)>> handlers;
+        std::atomic<bool> isDrainQueued{false};
+        std::atomic<bool> isStopping{false};
+        std::atomic<uint64_t> nDroppedDrains{0};
+
+        void drain();
+    };
+
+    // owned by the queued drain event. a drain dropped with the event, such as when the event queue is full
+    // or the EObject has moved, releases the queued flag and wakes the wait thread up to queue a new one
+    struct DrainTicket
+    {
+        explicit DrainTicket(std::shared_ptr<State> statePtr) : statePtr(std::move(statePtr)), isDrained(false){}
+        ~DrainTicket();
+        void drain();
+
+        std::shared_ptr<State> statePtr;
+        bool isDrained;
+    };
+
+    std::string mName;
+    size_t mCapacity;
+    size_t mSlotSize;
+    UntypedEObjectRef mRef;
+    std::shared_ptr<State> mStatePtr;
+    std::thread mWaitThread;
+
+    void runWaitThread();
+};
+
+/**
+ * @brief Sending end of an EShmQueue. Posts messages to an EShmReceiver in another process.
+ */
+class EShmProxy
+{
+public:
+    explicit EShmProxy(const std::string &name) : mQueuePtr(EShmQueue::open(name)){}
+
+    /**
+     * @brief Serialize the value into the queue. Trivially copyable values are copied straight into the slot.
+     *
+     * @return false if the queue is full
+     */
+    template<typename T>
+    bool post(uint32_t messageId, const T &value)
+    {
+        size_t size = EShmCodec<T>::size(value);
+        if(size > mQueuePtr->slotSize())
+            throw std::runtime_error("[EThread] EShmProxy::post() is called with a payload larger than the slot size.");
+        uint64_t position;
+        char *data = mQueuePtr->beginPush(messageId, size, position);
+        if(data == nullptr)
+            return false;
+        EShmCodec<T>::encode(value, data);
+        mQueuePtr->commitPush(position);
+        return true;
+    }
+
+private:
+    std::unique_ptr<EShmQueue> mQueuePtr;
+};
+
+}
+
+#endif
@@ -1,6 +1,26 @@
 #include "ethread.h"
+#include <algorithm>
+#include <iterator>
+#if defined(__linux__) && defined(__GLIBC__)
+#define EVENT_THREAD_STACK_SAMPLER
+#include <csignal>
+#include <ctime>
+#include <execinfo.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cstring>
+#endif
 
 ethr::EThread* ethr::EThread::mainEThreadPtr = nullptr;
+thread_local ethr::EThread* ethr::EThread::currentEThreadPtr = nullptr;
+thread_local int ethr::EThread::directCallDepth = 0;
 int ethr::EObject::idCount = 0;
 std::map<int, ethr::EObject*> ethr::EObject::activeEObjectIds;
 std::shared_mutex ethr::EObject::mutexActiveEObjectIds;
@@ -9,6 +29,7 @@ ethr::EObject::EObject()
 {
     mId = EObject::idCount++;
     mThreadInAffinity = nullptr;
+    mAffinityGeneration = 0;
 }
 
 void ethr::EObject::moveToThread(ethr::EThread& ethread)
@@ -17,20 +38,68 @@ void ethr::EObject::moveToThread(ethr::EThread& ethread)
 
     if(mThreadInAffinity)
         mThreadInAffinity->removeChildEObject(this);
+    mAffinityGeneration++;
     mThreadInAffinity = &ethread;
     mThreadInAffinity->addChildEObject(this);
 }
 
+void ethr::EObject::migrateToThread(ethr::EThread &ethread)
+{
+    if(!mThreadInAffinity)
+        throw std::runtime_error("[EThread] EObject::migrateToThread() is called but no EThread is assigned to it.");
+    mThreadInAffinity->migrateEObject(mId, ethread);
+}
+
 void ethr::EObject::removeFromThread()
 {
     if(!mThreadInAffinity)
         return;
     mThreadInAffinity->removeChildEObject(this);
     mThreadInAffinity = nullptr;
+    mAffinityGeneration++;
 
     onRemovedFromThread();
 }
 
+void ethr::EObject::moveToThread(const std::vector<EObject*> &eObjects, ethr::EThread &ethread)
+{
+    std::map<EThread*, std::vector<EObject*>> eObjectsByThread;
+    for(auto* eObjectPtr : eObjects)
+    {
+        eObjectPtr->onMovedToThread(ethread);
+        if(eObjectPtr->mThreadInAffinity)
+            eObjectsByThread[eObjectPtr->mThreadInAffinity].push_back(eObjectPtr);
+    }
+    for(auto& [ethreadPtr, threadEObjects] : eObjectsByThread)
+        ethreadPtr->removeChildEObjects(threadEObjects);
+    for(auto* eObjectPtr : eObjects)
+    {
+        eObjectPtr->mThreadInAffinity = &ethread;
+        eObjectPtr->mAffinityGeneration++;
+    }
+    ethread.addChildEObjects(eObjects);
+}
+
+void ethr::EObject::removeFromThread(const std::vector<EObject*> &eObjects)
+{
+    std::map<EThread*, std::vector<EObject*>> eObjectsByThread;
+    for(auto* eObjectPtr : eObjects)
+    {
+        if(eObjectPtr->mThreadInAffinity)
+            eObjectsByThread[eObjectPtr->mThreadInAffinity].push_back(eObjectPtr);
+    }
+    for(auto& [ethreadPtr, threadEObjects] : eObjectsByThread)
+    {
+        ethreadPtr->removeChildEObjects(threadEObjects);
+        for(auto* eObjectPtr : threadEObjects)
+        {
+            eObjectPtr->mThreadInAffinity = nullptr;
+            eObjectPtr->mAffinityGeneration++;
+            eObjectPtr->onRemovedFromThread();
+        }
+    }
+}
+
 ethr::EObject::~EObject()
 {
     if(mThreadInAffinity)
@@ -47,15 +116,120 @@ ethr::UntypedEObjectRef ethr::EObject::uref()
     return UntypedEObjectRef(mId, this);
 }
 
+#ifdef EVENT_THREAD_STACK_SAMPLER
+namespace
+{
+const int STACK_SAMPLE_SIGNAL = SIGRTMIN;
+const int MAX_STACK_SAMPLE_FRAMES = 64;
+thread_local void *stackSampleFrames[MAX_STACK_SAMPLE_FRAMES];
+thread_local volatile sig_atomic_t nStackSampleFrames = 0;
+
+void stackSampleSignalHandler(int)
+{
+    nStackSampleFrames = backtrace(stackSampleFrames, MAX_STACK_SAMPLE_FRAMES);
+}
+}
+
+// one-shot timer that signals the loop thread to sample its own stack when an event runs out of the budget
+struct ethr::EThread::StackSampler
+{
+    StackSampler()
+    {
+        static std::once_flag signalHandlerFlag;
+        std::call_once(signalHandlerFlag, []
+        {
+            // backtrace() loads libgcc on its first call, which is not safe in a signal handler
+            void *frame;
+            backtrace(&frame, 1);
+            struct sigaction action{};
+            action.sa_handler = stackSampleSignalHandler;
+            action.sa_flags = SA_RESTART;
+            sigemptyset(&action.sa_mask);
+            sigaction(STACK_SAMPLE_SIGNAL, &action, nullptr);
+        });
+        sigevent event{};
+        event.sigev_notify = SIGEV_THREAD_ID;
+        event.sigev_signo = STACK_SAMPLE_SIGNAL;
+        event._sigev_un._tid = gettid();
+        isCreated = timer_create(CLOCK_MONOTONIC, &event, &timer) == 0;
+    }
+    ~StackSampler()
+    {
+        if(isCreated)
+            timer_delete(timer);
+    }
+    void arm(const std::chrono::nanoseconds &budget)
+    {
+        nStackSampleFrames = 0;
+        if(!isCreated)
+            return;
+        itimerspec spec{};
+        spec.it_value.tv_sec = (time_t)(budget.count() / 1000000000);
+        spec.it_value.tv_nsec = (long)(budget.count() % 1000000000);
+        timer_settime(timer, 0, &spec, nullptr);
+    }
+    void disarm()
+    {
+        if(!isCreated)
+            return;
+        itimerspec spec{};
+        timer_settime(timer, 0, &spec, nullptr);
+    }
+    std::vector<std::string> takeStack()
+    {
+        std::vector<std::string> stack;
+        int nFrames = nStackSampleFrames;
+        nStackSampleFrames = 0;
+        if(nFrames <= 0)
+            return stack;
+        std::unique_ptr<char*, void(*)(void*)> symbols(backtrace_symbols(stackSampleFrames, nFrames), std::free);
+        if(symbols)
+            stack.assign(symbols.get(), symbols.get() + nFrames);
+        return stack;
+    }
+    timer_t timer;
+    bool isCreated;
+};
+#else
+struct ethr::EThread::StackSampler
+{
+    void arm(const std::chrono::nanoseconds &budget){}
+    void disarm(){}
+    std::vector<std::string> takeStack(){return {};}
+};
+#endif
+
 ethr::EThread::EThread(const std::string &name)
 {
     mIsMain = false;
     mName = name;
     mEventQueueSize = 1000;
+    mEventQueuePolicy = EventQueuePolicy::FIFO;
+    mEventQueueQuantum = std::chrono::microseconds(100);
+    mNEObjectQueueEvents = 0;
+    mEObjectGeneration = 0;
+    mNStaleEvents = 0;
+    mIsEObjectLoadTracked = false;
     mIsLoopRunning = false;
+    mLoopStartCount = 0;
+    mNDiscardedOnStop = 0;
+    mNextFixedRateTaskId = 0;
     mEventHandleScheme = EventHandleScheme::AFTER_TASK;
+    mIsEventDriven = false;
+    mCpuAffinity = -1;
     mLoopPeriod = std::chrono::milliseconds(1);
-    mNEventQueueReservedForHandle = 0;
+    mNHandlingEvents = 0;
+    mEventHandleBudgetCount = 0;
+    mEventHandleBudgetTime = std::chrono::nanoseconds(0);
+    mIsMetricsEnabled = true;
+    mDirectCallDepthLimit = 16;
+    mEpollFd = -1;
+    mEpollWakeFd = -1;
+    mEpollTimerFd = -1;
+    mIsEpollWaiting = false;
+    mSlowEventBudget = std::chrono::nanoseconds(0);
+    mIsSlowEventStackCaptured = false;
+    resetMetrics();
 }
 
 ethr::EThread::~EThread()
@@ -66,15 +240,15 @@ ethr::EThread::~EThread()
     }
     stop();
 
-    if(!mChildEObjectsIds.empty())
+    if(!mChildEObjects.empty())
         std::cerr<<"[EThread] EThread(" + mName + ") has child objects on destruction. "
                                                   "Use EObject::removeFromThread() before its destruction."<<std::endl;
+    closeEpoll();
 }
 
-bool ethr::EThread::checkLoopRunningSafe()
+bool ethr::EThread::checkLoopRunningSafe() const
 {
-    std::unique_lock<std::mutex> lock(mMutexLoop);
-    return mIsLoopRunning;
+    return mIsLoopRunning.load(std::memory_order_acquire);
 }
 
 void ethr::EThread::setName(const std::string& name)
@@ -100,26 +274,173 @@ void ethr::EThread::setEventHandleScheme(EventHandleScheme scheme)
     mEventHandleScheme = scheme;
 }
 
-void ethr::EThread::start()
+void ethr::EThread::setEventDriven(const bool &eventDriven)
 {
-    if(checkLoopRunningSafe())
+    if(checkLoopRunningSafe()) return;
+    mIsEventDriven = eventDriven;
+}
+
+void ethr::EThread::setCpuAffinity(const int &cpu)
+{
+    if(checkLoopRunningSafe()) return;
+    mCpuAffinity = cpu;
+}
+
+void ethr::EThread::setEpollEnabled(const bool &enabled)
+{
+    if(checkLoopRunningSafe()) return;
+#ifdef __linux__
+    if(!enabled)
+    {
+        closeEpoll();
+        return;
+    }
+    if(mEpollFd >= 0)
         return;
+    mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    mEpollWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    mEpollTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if(mEpollFd < 0 || mEpollWakeFd < 0 || mEpollTimerFd < 0)
+    {
+        std::string error = std::strerror(errno);
+        closeEpoll();
+        throw std::runtime_error("[EThread] Failed to create epoll of EThread(" + mName + "). " + error);
+    }
+    for(int fd : {mEpollWakeFd, mEpollTimerFd})
+    {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+#else
+    if(enabled)
+        throw std::runtime_error("[EThread] EThread::setEpollEnabled() is not supported on this platform.");
+#endif
+}
+
+void ethr::EThread::watchFd(const EObject &eObject, int fd, uint32_t events, std::function<void(uint32_t)> &&callback)
+{
+#ifdef __linux__
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    if(mEpollFd < 0)
+        throw std::runtime_error("[EThread] EThread::watchFd() is called but epoll of EThread(" + mName + ") is not enabled.");
+    if(mChildEObjects.find(eObject.mId) == mChildEObjects.end())
+        throw std::runtime_error("[EThread] EThread::watchFd() is called with an EObject not in EThread(" + mName + ").");
+    if(mFdWatches.find(fd) != mFdWatches.end())
+        throw std::runtime_error("[EThread] EThread::watchFd() is called with a fd already watched.");
+
+    // one shot, so that the fd does not report again until the callback has run and the fd is rearmed
+    epoll_event event{};
+    event.events = events | EPOLLONESHOT;
+    event.data.fd = fd;
+    if(epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+        throw std::runtime_error("[EThread] Failed to watch fd " + std::to_string(fd) + ". " + std::strerror(errno));
+    mFdWatches[fd] = {eObject.mId, events, std::make_shared<std::function<void(uint32_t)>>(std::move(callback))};
+#else
+    throw std::runtime_error("[EThread] EThread::watchFd() is not supported on this platform.");
+#endif
+}
+
+void ethr::EThread::unwatchFd(int fd)
+{
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    auto watchIter = mFdWatches.find(fd);
+    if(watchIter == mFdWatches.end())
+        return;
+#ifdef __linux__
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, nullptr);
+#endif
+    mFdWatches.erase(watchIter);
+}
+
+void ethr::EThread::setEventHandleBudget(const size_t &maxEvents, const std::chrono::nanoseconds &maxTime)
+{
+    if(checkLoopRunningSafe()) return;
+    mEventHandleBudgetCount = maxEvents;
+    mEventHandleBudgetTime = maxTime;
+}
+
+void ethr::EThread::setEventQueuePolicy(EventQueuePolicy policy, const std::chrono::nanoseconds &quantum)
+{
+    if(checkLoopRunningSafe()) return;
+    std::deque<Event> staleEvents;
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    mEventQueueQuantum = quantum;
+    if(policy == mEventQueuePolicy)
+        return;
+
+    // move the events queued before start to the queues of the new policy
+    std::deque<Event> events;
+    Event event;
+    while(popEvent(event, staleEvents))
+        events.push_back(std::move(event));
+    mEventQueuePolicy = policy;
+    for(auto& queuedEvent : events)
+    {
+        mChildEObjects[queuedEvent.eObjectId].nQueuedEvents++;
+        enqueueEvent(std::move(queuedEvent));
+    }
+}
+
+void ethr::EThread::setEObjectWeight(const EObject &eObject, const unsigned int &weight)
+{
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    mEObjectQueues[eObject.mId].weight = std::max(weight, 1u);
+}
 
-    mIsLoopRunning = true;
+void ethr::EThread::setDirectCallDepthLimit(const int &depth)
+{
+    if(checkLoopRunningSafe()) return;
+    mDirectCallDepthLimit = depth;
+}
+
+ethr::EThread *ethr::EThread::currentThread()
+{
+    return currentEThreadPtr;
+}
+
+bool ethr::EThread::enterDirectCall()
+{
+    if(currentEThreadPtr != this || directCallDepth >= mDirectCallDepthLimit)
+        return false;
+    directCallDepth++;
+    return true;
+}
+
+ethr::EThread::DirectCallExit::~DirectCallExit()
+{
+    directCallDepth--;
+}
+
+void ethr::EThread::setEventQueueSize(const size_t &size)
+{
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    mEventQueueSize = size;
+}
+
+void ethr::EThread::start()
+{
+    launch();
+}
+
+bool ethr::EThread::launch()
+{
+    bool isRunning = false;
+    if(!mIsLoopRunning.compare_exchange_strong(isRunning, true, std::memory_order_acq_rel))
+        return false;
 
     if(!mIsMain)
         mThread = std::thread(EThread::threadEntryPoint, this);
     else
         EThread::threadEntryPoint(this);
+    return true;
 }
 
 void ethr::EThread::stop()
 {
-    if(!checkLoopRunningSafe()) return;
+    if(!requestStop()) return;
 
-    mMutexLoop.lock();
-    mIsLoopRunning = false;
-    mMutexLoop.unlock();
     if(!mIsMain)
     {
         if(mThread.joinable())
@@ -127,59 +448,412 @@ void ethr::EThread::stop()
     }
 }
 
+size_t ethr::EThread::stop(StopMode mode, std::chrono::nanoseconds drainTimeout)
+{
+    if(!checkLoopRunningSafe()) return 0;
+
+    std::unique_lock<std::mutex> eventLock(mMutexEventQueue);
+    mStopMode = mode;
+    mStopDrainDeadline = std::chrono::high_resolution_clock::now() + drainTimeout;
+    mNDiscardedOnStop = 0;
+    eventLock.unlock();
+    if(!requestStop())
+        return 0;
+
+    if(mIsMain || !mThread.joinable())
+        return 0;
+    mThread.join();
+    return mNDiscardedOnStop;
+}
+
+bool ethr::EThread::requestStop()
+{
+    // only one of concurrent stops clears the flag and joins the thread
+    if(!mIsLoopRunning.exchange(false, std::memory_order_acq_rel))
+        return false;
+
+    // wake up the loop waiting for events. the loop checks the flag under mMutexEventQueue before it waits
+    std::unique_lock<std::mutex> eventLock(mMutexEventQueue);
+    mEventQueueCondition.notify_all();
+    wakeEpoll();
+    return true;
+}
+
+ethr::EThread::LifecycleReport ethr::EThread::startAll(const std::vector<EThread*> &ethreads)
+{
+    for(auto* ethreadPtr : ethreads)
+    {
+        if(ethreadPtr->mIsMain)
+            throw std::runtime_error("[EThread] EThread::startAll() is called with the main EThread(" + ethreadPtr->mName + ").");
+    }
+    LifecycleReport report{};
+    auto startTime = std::chrono::high_resolution_clock::now();
+    std::vector<uint32_t> loopStartCounts;
+    std::vector<bool> isLaunched;
+    loopStartCounts.reserve(ethreads.size());
+    isLaunched.reserve(ethreads.size());
+    for(auto* ethreadPtr : ethreads)
+    {
+        loopStartCounts.push_back(ethreadPtr->mLoopStartCount.load());
+        // a thread already running, or listed twice, has no start to wait for
+        isLaunched.push_back(ethreadPtr->launch());
+    }
+    for(size_t i=0; i<ethreads.size(); i++)
+    {
+        if(isLaunched[i])
+            ethreads[i]->mLoopStartCount.wait(loopStartCounts[i]);
+        report.threadTimes.emplace_back(ethreads[i]->mName, std::chrono::high_resolution_clock::now() - startTime);
+    }
+    report.totalTime = std::chrono::high_resolution_clock::now() - startTime;
+    return report;
+}
+
+ethr::EThread::LifecycleReport ethr::EThread::stopAll(const std::vector<EThread*> &ethreads)
+{
+    LifecycleReport report{};
+    auto startTime = std::chrono::high_resolution_clock::now();
+    std::vector<bool> isStopped;
+    isStopped.reserve(ethreads.size());
+    for(auto* ethreadPtr : ethreads)
+        isStopped.push_back(ethreadPtr->requestStop());
+    for(size_t i=0; i<ethreads.size(); i++)
+    {
+        EThread *ethreadPtr = ethreads[i];
+        if(isStopped[i] && !ethreadPtr->mIsMain && ethreadPtr->mThread.joinable())
+            ethreadPtr->mThread.join();
+        report.threadTimes.emplace_back(ethreadPtr->mName, std::chrono::high_resolution_clock::now() - startTime);
+    }
+    report.totalTime = std::chrono::high_resolution_clock::now() - startTime;
+    return report;
+}
+
+bool ethr::EThread::pushEvent(int eObjectId, ChildEObject &child, std::function<void()> &&func)
+{
+    if(eventQueueDepth() >= mEventQueueSize)
+    {
+        mNDroppedEvents++;
+        return false;
+    }
+    uint64_t traceId = 0;
+    if(ETracer::isTracing())
+        traceId = ETracer::recordQueued(eObjectId);
+    std::chrono::high_resolution_clock::time_point queuedTime;
+    if(mIsMetricsEnabled || traceId != 0)
+        queuedTime = std::chrono::high_resolution_clock::now();
+    enqueueEvent({eObjectId, child.generation, std::move(func), queuedTime, traceId});
+    child.nQueuedEvents++;
+    mNQueuedEvents++;
+    mMaxEventQueueDepth = std::max(mMaxEventQueueDepth, eventQueueDepth());
+    if(mIsEventDriven)
+        mEventQueueCondition.notify_one();
+    if(mIsEpollWaiting)
+        wakeEpoll();
+    return true;
+}
+
 void ethr::EThread::queueNewEvent(int eObjectId, std::function<void()> &&func)
 {
     std::unique_lock<std::mutex> lock(mMutexEventQueue);
-    if(std::find(mChildEObjectsIds.begin(), mChildEObjectsIds.end(), eObjectId) == mChildEObjectsIds.end())
+    auto childIter = mChildEObjects.find(eObjectId);
+    if(childIter == mChildEObjects.end())
+        return;
+    pushEvent(eObjectId, childIter->second, std::move(func));
+}
+
+void ethr::EThread::queueNewEvents(int eObjectId, std::vector<std::function<void()>> &&funcs)
+{
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    auto childIter = mChildEObjects.find(eObjectId);
+    if(childIter == mChildEObjects.end())
         return;
-    //if(mEventQueue.size() < mEventQueueSize) mEventQueue.emplace_back(eObjectId, func);
-    //auto a = std::make_pair(std::move(eObjectId), std::move(func));
-    if(mEventQueue.size() < mEventQueueSize) mEventQueue.emplace_back(eObjectId, std::move(func));
+    for(auto & func : funcs)
+        pushEvent(eObjectId, childIter->second, std::move(func));
+}
+
+void ethr::EThread::queueCoalescedEvent(int eObjectId, std::string &&key, std::function<void()> &&func)
+{
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    auto childIter = mChildEObjects.find(eObjectId);
+    if(childIter == mChildEObjects.end())
+        return;
+
+    // replace the pending one in place. it keeps its position in the queue
+    auto pendingIter = mCoalescedEvents.find({eObjectId, key});
+    if(pendingIter != mCoalescedEvents.end())
+    {
+        // the replaced function is destroyed after unlocking, since its captures may post on destruction
+        auto replacedFunc = std::move(pendingIter->second->func);
+        pendingIter->second->func = std::move(func);
+        lock.unlock();
+        return;
+    }
+
+    auto slot = std::make_shared<CoalescedEvent>(CoalescedEvent{std::move(func), this});
+    bool isQueued = pushEvent(eObjectId, childIter->second, [eObjectId, key, slot]
+    {
+        // take the latest one out so that posts from now on queue a new event.
+        // the slot is not migrated while its event runs, since migrations wait for the running event
+        EThread *ethreadPtr = slot->ethreadPtr;
+        std::unique_lock<std::mutex> lock(ethreadPtr->mMutexEventQueue);
+        auto latestFunc = std::move(slot->func);
+        auto pendingIter = ethreadPtr->mCoalescedEvents.find({eObjectId, key});
+        if(pendingIter != ethreadPtr->mCoalescedEvents.end() && pendingIter->second == slot)
+            ethreadPtr->mCoalescedEvents.erase(pendingIter);
+        lock.unlock();
+        latestFunc();
+    });
+    if(isQueued)
+        mCoalescedEvents.insert({{eObjectId, std::move(key)}, slot});
+    // a slot dropped by a full queue is destroyed after unlocking
+    lock.unlock();
 }
 
 void *ethr::EThread::threadEntryPoint(void *param)
 {
     auto* ethreadPtr = (EThread*)param;
-    ethreadPtr->mNextTaskTime = std::chrono::high_resolution_clock::now() + ethreadPtr->mLoopPeriod;
+    ETracer::setThreadName(ethreadPtr->mName);
+#ifdef __linux__
+    if(ethreadPtr->mCpuAffinity >= 0)
+    {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(ethreadPtr->mCpuAffinity, &cpuSet);
+        if(pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) != 0)
+            std::cerr<<"[EThread] Failed to pin EThread("<<ethreadPtr->mName<<") to CPU "<<ethreadPtr->mCpuAffinity<<"."<<std::endl;
+    }
+#else
+    if(ethreadPtr->mCpuAffinity >= 0)
+        std::cerr<<"[EThread] EThread::setCpuAffinity() is not supported on this platform."<<std::endl;
+#endif
+    if(ethreadPtr->mIsSlowEventStackCaptured && ethreadPtr->mSlowEventBudget.count() > 0)
+        ethreadPtr->mStackSamplerPtr = std::make_unique<StackSampler>();
+    auto startTime = std::chrono::high_resolution_clock::now();
+    ethreadPtr->mNextTaskTime = startTime + ethreadPtr->mLoopPeriod;
+    ethreadPtr->scheduleFixedRateTasks(startTime);
+    ethreadPtr->mLoopMetrics.startTimeNs.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+    currentEThreadPtr = ethreadPtr;
     ethreadPtr->runLoop();
+    currentEThreadPtr = nullptr;
+    ethreadPtr->mStackSamplerPtr.reset();
     return nullptr;
 }
 
 void ethr::EThread::handleQueuedEvents()
 {
-    // lock mMutexEventHandling to prohibit event deletion when child EObject::removeFromThread()
-    std::unique_lock<std::mutex> executionLock(mMutexEventHandling, std::defer_lock);
-    if(mNEventQueueReservedForHandle == 0)
+    auto startTime = std::chrono::high_resolution_clock::now();
+    // stale events skipped by popEvent() are destroyed after unlocking, since their captures may post on destruction
+    std::deque<Event> staleEvents;
+    std::unique_lock<std::mutex> eventLock(mMutexEventQueue);
+    if(!mPendingMigrations.empty() && mNHandlingEvents == 0)
     {
-        executionLock.lock();
+        eventLock.unlock();
+        runPendingMigrations();
+        eventLock.lock();
     }
 
+    // events queued by the handlers during this call are left for the next call
+    size_t nHandling = eventQueueDepth();
+    bool isBudgetExhausted = false;
+    if(mEventHandleBudgetCount > 0 && nHandling > mEventHandleBudgetCount)
+    {
+        nHandling = mEventHandleBudgetCount;
+        isBudgetExhausted = true;
+    }
 
-    size_t nQueuedEvent = mEventQueue.size();
-    size_t nHandlingEventsHere = nQueuedEvent - mNEventQueueReservedForHandle;
-    size_t iHandleStartEvent = mNEventQueueReservedForHandle;
-    mNEventQueueReservedForHandle += nHandlingEventsHere;
-
-    for(int i=0; i<nHandlingEventsHere; i++)
+    for(size_t i=0; i<nHandling; i++)
     {
-        // lock mMutexEventQueue to access event queue
-        std::unique_lock<std::mutex> eventLock(mMutexEventQueue);
+        if(mEventHandleBudgetTime.count() > 0 && i > 0
+            && std::chrono::high_resolution_clock::now() - startTime >= mEventHandleBudgetTime)
+        {
+            isBudgetExhausted = true;
+            break;
+        }
+
+        if(isStopDue())
+            break;
 
-        if(!(mEventQueue[iHandleStartEvent + i].second))
-            std::cerr<<"empty function detected in queue"<<std::endl;
-        auto func = std::move(mEventQueue[iHandleStartEvent + i].second);
+        Event event;
+        if(!popEvent(event, staleEvents))
+            break;
+        mNHandlingEvents++;
 
         // unlocking mMutexEventQueue allows event push between event executions
         eventLock.unlock();
+        staleEvents.clear();
+        auto elapsed = handleEvent(event);
+        // the captures are destroyed before locking, since they may post on destruction
+        event.func = nullptr;
+        eventLock.lock();
+
+        mNHandlingEvents--;
+        if(mEventQueuePolicy == EventQueuePolicy::FAIR)
+            chargeEvent(event.eObjectId, elapsed);
+        if(mIsEObjectLoadTracked)
+        {
+            auto childIter = mChildEObjects.find(event.eObjectId);
+            if(childIter != mChildEObjects.end())
+            {
+                childIter->second.handleTimeNs += elapsed.count();
+                childIter->second.nHandledEvents++;
+            }
+        }
+        notifyIfIdle();
 
-       // execute function
-       func();
+        // the EObjects are between events only out of any handler
+        if(!mPendingMigrations.empty() && mNHandlingEvents == 0)
+        {
+            eventLock.unlock();
+            runPendingMigrations();
+            eventLock.lock();
+        }
+    }
+    eventLock.unlock();
+
+    if(isBudgetExhausted && mIsMetricsEnabled)
+        mLoopMetrics.nBudgetExhaustions.store(mLoopMetrics.nBudgetExhaustions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+std::chrono::nanoseconds ethr::EThread::handleEvent(Event &event)
+{
+    if(!event.func)
+    {
+        std::cerr<<"empty function detected in queue"<<std::endl;
+        return std::chrono::nanoseconds(0);
+    }
+
+    if(!mIsMetricsEnabled && event.traceId == 0 && mSlowEventBudget.count() == 0 && mEventQueuePolicy == EventQueuePolicy::FIFO
+        && !mIsEObjectLoadTracked)
+    {
+        event.func();
+        return std::chrono::nanoseconds(0);
+    }
+
+    // execute function
+    if(mStackSamplerPtr)
+        mStackSamplerPtr->arm(mSlowEventBudget);
+    auto startTime = std::chrono::high_resolution_clock::now();
+    event.func();
+    auto endTime = std::chrono::high_resolution_clock::now();
+    if(mStackSamplerPtr)
+        mStackSamplerPtr->disarm();
+    if(event.traceId != 0)
+        ETracer::recordHandled(event.traceId, event.eObjectId, event.func.target_type(), event.queuedTime, startTime, endTime);
+    if(mSlowEventBudget.count() > 0 && endTime - startTime > mSlowEventBudget)
+        reportSlowEvent(event.eObjectId, &event.func.target_type(), endTime - startTime);
+    if(!mIsMetricsEnabled)
+        return endTime - startTime;
+    mLoopMetrics.queueLatency.record(startTime - event.queuedTime);
+    mLoopMetrics.handleLatency.record(endTime - startTime);
+    mLoopMetrics.nHandledEvents.store(mLoopMetrics.nHandledEvents.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    mLoopMetrics.busyTimeNs.store(mLoopMetrics.busyTimeNs.load(std::memory_order_relaxed)
+        + std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count(), std::memory_order_relaxed);
+    return endTime - startTime;
+}
+
+size_t ethr::EThread::eventQueueDepth() const
+{
+    return mEventQueue.size() + mNEObjectQueueEvents - mNStaleEvents;
+}
+
+void ethr::EThread::enqueueEvent(Event &&event)
+{
+    if(mEventQueuePolicy == EventQueuePolicy::FIFO)
+    {
+        mEventQueue.push_back(std::move(event));
+        return;
+    }
+    auto& queue = mEObjectQueues[event.eObjectId];
+    if(!queue.isActive)
+    {
+        queue.isActive = true;
+        mActiveEObjectQueueIds.push_back(event.eObjectId);
+    }
+    queue.events.push_back(std::move(event));
+    mNEObjectQueueEvents++;
+}
+
+bool ethr::EThread::popEvent(Event &event, std::deque<Event> &staleEvents)
+{
+    if(mEventQueuePolicy == EventQueuePolicy::FIFO)
+    {
+        while(!mEventQueue.empty())
+        {
+            event = std::move(mEventQueue.front());
+            mEventQueue.pop_front();
+            if(acceptPoppedEvent(event))
+                return true;
+            staleEvents.push_back(std::move(event));
+        }
+        return false;
     }
 
-    for(int i=0; i<nHandlingEventsHere; i++)
-        mEventQueue.pop_front();
+    // deficit round robin. every turn of an EObject adds quantum x weight of handler time,
+    // and its events are handled until the handler time spent exceeds it
+    while(!mActiveEObjectQueueIds.empty())
+    {
+        int eObjectId = mActiveEObjectQueueIds.front();
+        auto& queue = mEObjectQueues[eObjectId];
+        if(!queue.isTurnStarted)
+        {
+            queue.deficitNs += mEventQueueQuantum.count() * queue.weight;
+            queue.isTurnStarted = true;
+        }
+        if(queue.deficitNs > 0 && !queue.events.empty())
+        {
+            event = std::move(queue.events.front());
+            queue.events.pop_front();
+            mNEObjectQueueEvents--;
+            if(!acceptPoppedEvent(event))
+            {
+                staleEvents.push_back(std::move(event));
+                continue;
+            }
+            return true;
+        }
+        queue.isTurnStarted = false;
+        mActiveEObjectQueueIds.pop_front();
+        if(queue.events.empty())
+        {
+            queue.isActive = false;
+            queue.deficitNs = 0;
+            eraseEObjectQueueIfUnused(eObjectId);
+        }
+        else
+        {
+            mActiveEObjectQueueIds.push_back(eObjectId);
+        }
+    }
+    return false;
+}
 
-    mNEventQueueReservedForHandle -= nHandlingEventsHere;
+bool ethr::EThread::acceptPoppedEvent(const Event &event)
+{
+    auto childIter = mChildEObjects.find(event.eObjectId);
+    if(childIter == mChildEObjects.end() || childIter->second.generation != event.generation)
+    {
+        mNStaleEvents--;
+        return false;
+    }
+    childIter->second.nQueuedEvents--;
+    return true;
+}
+
+void ethr::EThread::chargeEvent(int eObjectId, std::chrono::nanoseconds elapsed)
+{
+    auto iter = mEObjectQueues.find(eObjectId);
+    if(iter == mEObjectQueues.end())
+        return;
+    iter->second.deficitNs -= elapsed.count();
+}
+
+void ethr::EThread::eraseEObjectQueueIfUnused(int eObjectId)
+{
+    auto iter = mEObjectQueues.find(eObjectId);
+    if(iter == mEObjectQueues.end() || iter->second.isActive || !iter->second.events.empty())
+        return;
+    if(mChildEObjects.find(eObjectId) == mChildEObjects.end())
+        mEObjectQueues.erase(iter);
 }
 
 void ethr::EThread::stopMainThread()
@@ -192,59 +866,650 @@ void ethr::EThread::stopMainThread()
                 "Main EThread is assigned by calling EThread::start(true) with isMain=true argument.");
 }
 
+void ethr::EThread::runTask()
+{
+    bool isTracing = ETracer::isTracing();
+    if(!mIsMetricsEnabled && !isTracing && mSlowEventBudget.count() == 0)
+    {
+        task();
+        return;
+    }
+
+    if(mStackSamplerPtr)
+        mStackSamplerPtr->arm(mSlowEventBudget);
+    auto startTime = std::chrono::high_resolution_clock::now();
+    task();
+    auto endTime = std::chrono::high_resolution_clock::now();
+    if(mStackSamplerPtr)
+        mStackSamplerPtr->disarm();
+    if(isTracing)
+        ETracer::recordTask(startTime, endTime);
+    if(mSlowEventBudget.count() > 0 && endTime - startTime > mSlowEventBudget)
+        reportSlowEvent(-1, nullptr, endTime - startTime);
+    if(!mIsMetricsEnabled)
+        return;
+    auto elapsed = endTime - startTime;
+    mLoopMetrics.taskLatency.record(elapsed);
+    mLoopMetrics.busyTimeNs.store(mLoopMetrics.busyTimeNs.load(std::memory_order_relaxed)
+        + std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+}
+
+bool ethr::EThread::waitForNextLoop()
+{
+    if(mEpollFd >= 0)
+        return waitForEpoll();
+
+    auto wakeUpTime = nextWakeUpTime();
+    if(!mIsEventDriven || mEventHandleScheme == EventHandleScheme::USER_CONTROLLED)
+    {
+        // without a period task() runs back to back, and the fixed-rate tasks between its runs
+        if(mLoopPeriod.count() == 0)
+            return true;
+        std::this_thread::sleep_for(wakeUpTime - std::chrono::high_resolution_clock::now());
+        return wakeUpTime == mNextTaskTime;
+    }
+
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    auto isWokenUp = [&]{ return eventQueueDepth() > 0 || !mPendingMigrations.empty() || !checkLoopRunningSafe(); };
+    if(mLoopPeriod.count() == 0)
+    {
+        if(mFixedRateDeadlines.empty())
+            mEventQueueCondition.wait(lock, isWokenUp);
+        else
+            mEventQueueCondition.wait_until(lock, wakeUpTime, isWokenUp);
+        return true;
+    }
+    mEventQueueCondition.wait_until(lock, wakeUpTime, isWokenUp);
+    // a steady stream of events must not starve task()
+    return std::chrono::high_resolution_clock::now() >= mNextTaskTime;
+}
+
+std::chrono::high_resolution_clock::time_point ethr::EThread::nextWakeUpTime() const
+{
+    if(mFixedRateDeadlines.empty())
+        return mNextTaskTime;
+    auto fixedRateDeadline = mFixedRateDeadlines.top().first;
+    if(mLoopPeriod.count() == 0)
+        return fixedRateDeadline;
+    return std::min(mNextTaskTime, fixedRateDeadline);
+}
+
+int ethr::EThread::addFixedRateTask(std::chrono::nanoseconds period, std::function<void()> &&callback, std::chrono::nanoseconds phase)
+{
+    if(checkLoopRunningSafe())
+        throw std::runtime_error("[EThread] EThread::addFixedRateTask() is called while EThread(" + mName + ") is running.");
+    if(period.count() <= 0)
+        throw std::runtime_error("[EThread] EThread::addFixedRateTask() is called with a non-positive period.");
+    int id = mNextFixedRateTaskId++;
+    auto& task = mFixedRateTasks[id];
+    task.period = period;
+    task.phase = phase;
+    task.callback = std::move(callback);
+    return id;
+}
+
+bool ethr::EThread::removeFixedRateTask(int id)
+{
+    if(checkLoopRunningSafe())
+        throw std::runtime_error("[EThread] EThread::removeFixedRateTask() is called while EThread(" + mName + ") is running.");
+    return mFixedRateTasks.erase(id) > 0;
+}
+
+std::vector<ethr::EThread::FixedRateTaskStats> ethr::EThread::fixedRateTaskStats() const
+{
+    std::vector<FixedRateTaskStats> stats;
+    for(auto& [id, task] : mFixedRateTasks)
+    {
+        stats.push_back({id, task.period, task.nRuns.load(std::memory_order_relaxed), task.nOverruns.load(std::memory_order_relaxed),
+                         task.nSkippedRuns.load(std::memory_order_relaxed),
+                         std::chrono::nanoseconds(task.maxLatenessNs.load(std::memory_order_relaxed)),
+                         std::chrono::nanoseconds(task.maxRunTimeNs.load(std::memory_order_relaxed))});
+    }
+    return stats;
+}
+
+void ethr::EThread::scheduleFixedRateTasks(std::chrono::high_resolution_clock::time_point startTime)
+{
+    mFixedRateDeadlines = {};
+    for(auto& [id, task] : mFixedRateTasks)
+        mFixedRateDeadlines.emplace(startTime + task.phase, id);
+}
+
+void ethr::EThread::runFixedRateTasks()
+{
+    if(mFixedRateDeadlines.empty())
+        return;
+    auto now = std::chrono::high_resolution_clock::now();
+    while(mFixedRateDeadlines.top().first <= now)
+    {
+        auto [deadline, id] = mFixedRateDeadlines.top();
+        mFixedRateDeadlines.pop();
+        auto& task = mFixedRateTasks.at(id);
+
+        auto startTime = now;
+        task.callback();
+        auto endTime = std::chrono::high_resolution_clock::now();
+
+        // fixed step: the next deadline is a whole number of periods from the first one.
+        // the deadlines passed while running are skipped so that a slow run does not cause a burst
+        auto nextDeadline = deadline + task.period;
+        if(endTime > nextDeadline)
+        {
+            auto nSkipped = (endTime - deadline) / task.period;
+            nextDeadline = deadline + task.period * (nSkipped + 1);
+            task.nOverruns.store(task.nOverruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            task.nSkippedRuns.store(task.nSkippedRuns.load(std::memory_order_relaxed) + nSkipped, std::memory_order_relaxed);
+        }
+        mFixedRateDeadlines.emplace(nextDeadline, id);
+
+        int64_t latenessNs = std::chrono::duration_cast<std::chrono::nanoseconds>(startTime - deadline).count();
+        int64_t runTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+        task.nRuns.store(task.nRuns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if(latenessNs > task.maxLatenessNs.load(std::memory_order_relaxed))
+            task.maxLatenessNs.store(latenessNs, std::memory_order_relaxed);
+        if(runTimeNs > task.maxRunTimeNs.load(std::memory_order_relaxed))
+            task.maxRunTimeNs.store(runTimeNs, std::memory_order_relaxed);
+        if(mIsMetricsEnabled)
+            mLoopMetrics.busyTimeNs.store(mLoopMetrics.busyTimeNs.load(std::memory_order_relaxed) + runTimeNs, std::memory_order_relaxed);
+        now = endTime;
+    }
+}
+
+bool ethr::EThread::waitForEpoll()
+{
+#ifdef __linux__
+    // queued events wake the loop up like event-driven loops, unless the events are handled by the user
+    bool isWokenByEvents = mEventHandleScheme != EventHandleScheme::USER_CONTROLLED;
+    epoll_event readyEvents[16];
+    while(checkLoopRunningSafe())
+    {
+        auto now = std::chrono::high_resolution_clock::now();
+        if(mLoopPeriod.count() > 0 && mNextTaskTime <= now)
+            return true;
+        if(!mFixedRateDeadlines.empty() && mFixedRateDeadlines.top().first <= now)
+            return false;
+        bool hasDeadline = mLoopPeriod.count() > 0 || !mFixedRateDeadlines.empty();
+        auto remainingTime = nextWakeUpTime() - now;
+
+        std::unique_lock<std::mutex> lock(mMutexEventQueue);
+        if(isWokenByEvents && (eventQueueDepth() > 0 || !mPendingMigrations.empty()))
+            return mLoopPeriod.count() == 0;
+        if(!isWokenByEvents && mLoopPeriod.count() == 0)
+            return true;
+        mIsEpollWaiting = isWokenByEvents;
+        lock.unlock();
+
+        // the deadlines are kept by a timerfd, which has a finer resolution than the timeout of epoll_wait()
+        itimerspec timerSpec{};
+        if(hasDeadline)
+        {
+            auto remainingNs = std::chrono::duration_cast<std::chrono::nanoseconds>(remainingTime).count();
+            timerSpec.it_value.tv_sec = remainingNs / 1000000000;
+            timerSpec.it_value.tv_nsec = remainingNs % 1000000000;
+        }
+        timerfd_settime(mEpollTimerFd, 0, &timerSpec, nullptr);
+        int nReadyEvents = epoll_wait(mEpollFd, readyEvents, 16, -1);
+
+        lock.lock();
+        mIsEpollWaiting = false;
+        for(int i=0; i<nReadyEvents; i++)
+        {
+            int fd = readyEvents[i].data.fd;
+            if(fd == mEpollWakeFd || fd == mEpollTimerFd)
+            {
+                uint64_t count;
+                while(read(fd, &count, sizeof(count)) > 0);
+                continue;
+            }
+            queueFdEvent(fd, readyEvents[i].events);
+        }
+    }
+#endif
+    return true;
+}
+
+void ethr::EThread::queueFdEvent(int fd, uint32_t readyEvents)
+{
+    auto watchIter = mFdWatches.find(fd);
+    if(watchIter == mFdWatches.end())
+        return;
+    auto childIter = mChildEObjects.find(watchIter->second.eObjectId);
+    if(childIter == mChildEObjects.end())
+        return;
+    auto callback = watchIter->second.callback;
+    bool isQueued = pushEvent(watchIter->second.eObjectId, childIter->second, [this, fd, readyEvents, callback]
+    {
+        std::unique_lock<std::mutex> lock(mMutexEventQueue);
+        auto watchIter = mFdWatches.find(fd);
+        // unwatched or watched again after the readiness was queued
+        if(watchIter == mFdWatches.end() || watchIter->second.callback != callback)
+            return;
+        lock.unlock();
+        (*callback)(readyEvents);
+        lock.lock();
+        watchIter = mFdWatches.find(fd);
+        if(watchIter != mFdWatches.end() && watchIter->second.callback == callback)
+            rearmFd(fd, watchIter->second.events);
+    });
+    // the fd is still ready, so it reports again on the next wait
+    if(!isQueued)
+        rearmFd(fd, watchIter->second.events);
+}
+
+void ethr::EThread::rearmFd(int fd, uint32_t events)
+{
+#ifdef __linux__
+    epoll_event event{};
+    event.events = events | EPOLLONESHOT;
+    event.data.fd = fd;
+    epoll_ctl(mEpollFd, EPOLL_CTL_MOD, fd, &event);
+#endif
+}
+
+void ethr::EThread::wakeEpoll()
+{
+#ifdef __linux__
+    if(mEpollWakeFd < 0)
+        return;
+    uint64_t count = 1;
+    if(write(mEpollWakeFd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        std::cerr<<"[EThread] Failed to wake up EThread("<<mName<<"). "<<std::strerror(errno)<<std::endl;
+    mIsEpollWaiting = false;
+#endif
+}
+
+void ethr::EThread::closeEpoll()
+{
+#ifdef __linux__
+    for(int* fdPtr : {&mEpollFd, &mEpollWakeFd, &mEpollTimerFd})
+    {
+        if(*fdPtr >= 0)
+            close(*fdPtr);
+        *fdPtr = -1;
+    }
+    mFdWatches.clear();
+#endif
+}
+
 void ethr::EThread::runLoop()
 {
     onStart();
+    mLoopStartCount++;
+    mLoopStartCount.notify_all();
 
     while(checkLoopRunningSafe())
     {
-        std::this_thread::sleep_for(mNextTaskTime - std::chrono::high_resolution_clock::now());
+        bool isTaskTime = waitForNextLoop();
+        if(mLoopMetrics.isResetRequested.load(std::memory_order_acquire))
+            resetLoopMetrics();
+        runFixedRateTasks();
+        if(!isTaskTime)
+        {
+            // woken up by events, or by a fixed-rate task. user-controlled events are left to the user
+            if(mEventHandleScheme != EventHandleScheme::USER_CONTROLLED)
+                handleQueuedEvents();
+            continue;
+        }
         mNextTaskTime += mLoopPeriod;
 
         switch(mEventHandleScheme)
         {
         case EventHandleScheme::AFTER_TASK:
         {
-            task();
+            runTask();
             handleQueuedEvents();
             break;
         }
         case EventHandleScheme::BEFORE_TASK:
         {
             handleQueuedEvents();
-            task();
+            runTask();
             break;
         }
         case EventHandleScheme::USER_CONTROLLED:
         {
-            task();
+            runTask();
             break;
         }
         }
+
+        if(mIsMetricsEnabled)
+        {
+            mLoopMetrics.nLoops.store(mLoopMetrics.nLoops.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            if(mLoopPeriod.count() > 0 && std::chrono::high_resolution_clock::now() > mNextTaskTime)
+                mLoopMetrics.nLoopOverruns.store(mLoopMetrics.nLoopOverruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
     }
 
+    settleEventsOnStop();
+    if(mLoopMetrics.isResetRequested.load(std::memory_order_acquire))
+        resetLoopMetrics();
     onTerminate();
 }
 
-void ethr::EThread::addChildEObject(ethr::EObject *eObjectPtr)
+void ethr::EThread::settleEventsOnStop()
 {
-    std::unique_lock<std::mutex> lock(mMutexChildObjects);
-    std::unique_lock<std::shared_mutex> activeEObjectsLock(EObject::mutexActiveEObjectIds);
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    if(!mStopMode)
+        return;
+    while(eventQueueDepth() > 0 && !isStopDue())
+    {
+        lock.unlock();
+        handleQueuedEvents();
+        lock.lock();
+    }
+    mStopMode.reset();
+    lock.unlock();
+    mNDiscardedOnStop = discardQueuedEvents();
+}
 
-    mChildEObjectsIds.push_back(eObjectPtr->mId);
-    EObject::activeEObjectIds.insert({eObjectPtr->mId, eObjectPtr});
+bool ethr::EThread::isStopDue() const
+{
+    if(!mStopMode)
+        return false;
+    switch(*mStopMode)
+    {
+    case StopMode::DISCARD:
+        return true;
+    case StopMode::DRAIN:
+        return false;
+    case StopMode::DRAIN_UNTIL:
+        return std::chrono::high_resolution_clock::now() >= mStopDrainDeadline;
+    }
+    return false;
+}
+
+size_t ethr::EThread::discardQueuedEvents()
+{
+    // the events are destroyed after unlocking, since their captures may post on destruction
+    std::deque<Event> events;
+    std::vector<std::deque<Event>> eObjectEvents;
+    CoalescedEvents coalescedEvents;
+
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    size_t nDiscarded = eventQueueDepth();
+    events.swap(mEventQueue);
+    for(auto& [eObjectId, eObjectQueue] : mEObjectQueues)
+    {
+        if(!eObjectQueue.events.empty())
+            eObjectEvents.push_back(std::move(eObjectQueue.events));
+        eObjectQueue.events.clear();
+        eObjectQueue.deficitNs = 0;
+        eObjectQueue.isTurnStarted = false;
+        eObjectQueue.isActive = false;
+    }
+    std::erase_if(mEObjectQueues, [&](const auto& pair){ return mChildEObjects.find(pair.first) == mChildEObjects.end(); });
+    mActiveEObjectQueueIds.clear();
+    mNEObjectQueueEvents = 0;
+    mNStaleEvents = 0;
+    for(auto& [eObjectId, child] : mChildEObjects)
+        child.nQueuedEvents = 0;
+    coalescedEvents.swap(mCoalescedEvents);
+    mNDroppedEvents += nDiscarded;
+    notifyIfIdle();
+    return nDiscarded;
+}
+
+bool ethr::EThread::isIdle() const
+{
+    return eventQueueDepth() == 0 && mNHandlingEvents == 0;
+}
+
+void ethr::EThread::notifyIfIdle()
+{
+    if(isIdle())
+        mIdleCondition.notify_all();
+}
+
+void ethr::EThread::addChildEObject(ethr::EObject *eObjectPtr)
+{
+    addChildEObjects({eObjectPtr});
 }
 
 void ethr::EThread::removeChildEObject(EObject* eObjectPtr)
 {
-    std::unique_lock<std::mutex> childObjectsLock(mMutexChildObjects);
-    std::unique_lock<std::mutex> executionLock(mMutexEventHandling, std::defer_lock);
+    removeChildEObjects({eObjectPtr});
+}
+
+void ethr::EThread::addChildEObjects(const std::vector<EObject*> &eObjects)
+{
     std::unique_lock<std::mutex> eventLock(mMutexEventQueue);
+    for(auto* eObjectPtr : eObjects)
+        mChildEObjects[eObjectPtr->mId] = {++mEObjectGeneration, 0, 0, 0};
+    eventLock.unlock();
+
     std::unique_lock<std::shared_mutex> activeEObjectsLock(EObject::mutexActiveEObjectIds);
+    for(auto* eObjectPtr : eObjects)
+        EObject::activeEObjectIds.insert({eObjectPtr->mId, eObjectPtr});
+}
 
-    std::erase_if(mChildEObjectsIds, [&](int id){return id == eObjectPtr->mId;});
-    std::erase_if(mEventQueue, [&](std::pair<int, std::function<void(void)>>& pair){return pair.first==eObjectPtr->mId;});
-    EObject::activeEObjectIds.erase(eObjectPtr->mId);
+void ethr::EThread::removeChildEObjects(const std::vector<EObject*> &eObjects)
+{
+    // EObjectRef locks mutexActiveEObjectIds before mMutexEventQueue, so the two are not held together.
+    // an EObject migrated before its removal is erased from the EThread it was migrated to
+    std::map<EThread*, std::vector<int>> eObjectIdsByThread;
+    std::unique_lock<std::shared_mutex> activeEObjectsLock(EObject::mutexActiveEObjectIds);
+    for(auto* eObjectPtr : eObjects)
+    {
+        EObject::activeEObjectIds.erase(eObjectPtr->mId);
+        eObjectIdsByThread[eObjectPtr->mThreadInAffinity ? eObjectPtr->mThreadInAffinity : this].push_back(eObjectPtr->mId);
+    }
+    activeEObjectsLock.unlock();
+
+    // queued events of the EObjects are destroyed after unlocking, which breaks the promises of their callAsync()
+    std::deque<Event> removedEvents;
+    for(auto& [ethreadPtr, eObjectIds] : eObjectIdsByThread)
+    {
+        std::unique_lock<std::mutex> eventLock(ethreadPtr->mMutexEventQueue);
+        for(int eObjectId : eObjectIds)
+            ethreadPtr->eraseChildEObject(eObjectId, removedEvents);
+        ethreadPtr->notifyIfIdle();
+    }
+}
+
+void ethr::EThread::setEObjectLoadTracking(const bool &enabled)
+{
+    if(enabled == mIsEObjectLoadTracked)
+        return;
+    if(checkLoopRunningSafe())
+        throw std::runtime_error("[EThread] EThread::setEObjectLoadTracking() is called while EThread(" + mName + ") is running.");
+    mIsEObjectLoadTracked = enabled;
+}
+
+std::vector<ethr::EThread::EObjectLoad> ethr::EThread::takeEObjectLoads()
+{
+    std::vector<EObjectLoad> loads;
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    loads.reserve(mChildEObjects.size());
+    for(auto& [eObjectId, child] : mChildEObjects)
+    {
+        loads.push_back({eObjectId, std::chrono::nanoseconds(child.handleTimeNs), child.nHandledEvents, child.nQueuedEvents});
+        child.handleTimeNs = 0;
+        child.nHandledEvents = 0;
+    }
+    return loads;
+}
+
+void ethr::EThread::migrateEObject(int eObjectId, ethr::EThread &target)
+{
+    if(&target == this)
+        return;
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    mPendingMigrations.push_back({eObjectId, &target});
+    if(checkLoopRunningSafe())
+    {
+        if(mIsEventDriven)
+            mEventQueueCondition.notify_one();
+        if(mIsEpollWaiting)
+            wakeEpoll();
+        return;
+    }
+    lock.unlock();
+    runPendingMigrations();
+}
+
+void ethr::EThread::runPendingMigrations()
+{
+    // EObjectRef resolves the EThread of an EObject under mutexActiveEObjectIds, so no event is pushed to
+    // the EObject during the migration, and removeChildEObjects() sees the EThread it ends up in
+    std::deque<Event> staleEvents;     // destroyed after unlocking
+    std::unique_lock<std::shared_mutex> activeEObjectsLock(EObject::mutexActiveEObjectIds);
+    std::unique_lock<std::mutex> eventLock(mMutexEventQueue);
+    auto migrations = std::move(mPendingMigrations);
+    mPendingMigrations.clear();
+    for(auto& migration : migrations)
+        migrateChildEObject(migration.eObjectId, *migration.targetPtr, staleEvents);
+    notifyIfIdle();
+}
+
+bool ethr::EThread::isMigrationPending(int eObjectId)
+{
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    return std::any_of(mPendingMigrations.begin(), mPendingMigrations.end(),
+                       [&](const Migration &migration){ return migration.eObjectId == eObjectId; });
+}
+
+void ethr::EThread::migrateChildEObject(int eObjectId, ethr::EThread &target, std::deque<Event> &staleEvents)
+{
+    // removed or moved since requested
+    auto eObjectIter = EObject::activeEObjectIds.find(eObjectId);
+    auto childIter = mChildEObjects.find(eObjectId);
+    if(eObjectIter == EObject::activeEObjectIds.end() || childIter == mChildEObjects.end()
+        || eObjectIter->second->mThreadInAffinity != this)
+        return;
+    bool isWatchingFd = std::any_of(mFdWatches.begin(), mFdWatches.end(),
+                                    [&](const auto& pair){ return pair.second.eObjectId == eObjectId; });
+    if(isWatchingFd)
+    {
+        std::cerr<<"[EThread] EObject("<<eObjectId<<") watching file descriptors is not migrated from EThread("<<mName<<")."<<std::endl;
+        return;
+    }
+
+    // take the events of the current generation out in order. the stale ones are left to be skipped
+    uint64_t generation = childIter->second.generation;
+    std::deque<Event> events;
+    if(childIter->second.nQueuedEvents > 0 && !mEventQueue.empty())
+    {
+        std::deque<Event> remainingEvents;
+        for(auto& event : mEventQueue)
+        {
+            if(event.eObjectId == eObjectId && event.generation == generation)
+                events.push_back(std::move(event));
+            else
+                remainingEvents.push_back(std::move(event));
+        }
+        mEventQueue.swap(remainingEvents);
+    }
+    unsigned int weight = 1;
+    auto eObjectQueueIter = mEObjectQueues.find(eObjectId);
+    if(eObjectQueueIter != mEObjectQueues.end())
+    {
+        // an emptied queue left in the round robin is dropped by popEvent()
+        auto& queue = eObjectQueueIter->second;
+        weight = queue.weight;
+        queue.weight = 1;
+        for(auto& event : queue.events)
+        {
+            if(event.generation == generation)
+                events.push_back(std::move(event));
+            else
+            {
+                staleEvents.push_back(std::move(event));
+                mNStaleEvents--;
+            }
+        }
+        mNEObjectQueueEvents -= queue.events.size();
+        queue.events.clear();
+    }
+    mChildEObjects.erase(childIter);
+    eraseEObjectQueueIfUnused(eObjectId);
+    // the pending coalesced events go along with their carried events, so that later posts on the target replace them
+    CoalescedEvents coalescedEvents;
+    auto coalescedBegin = mCoalescedEvents.lower_bound({eObjectId, std::string()});
+    auto coalescedEnd = mCoalescedEvents.lower_bound({eObjectId + 1, std::string()});
+    for(auto coalescedIter = coalescedBegin; coalescedIter != coalescedEnd; ++coalescedIter)
+    {
+        coalescedIter->second->ethreadPtr = &target;
+        coalescedEvents.insert(std::move(*coalescedIter));
+    }
+    mCoalescedEvents.erase(coalescedBegin, coalescedEnd);
+
+    eObjectIter->second->mThreadInAffinity = &target;
+    target.adoptChildEObject(eObjectId, weight, std::move(events), std::move(coalescedEvents));
+}
+
+void ethr::EThread::adoptChildEObject(int eObjectId, unsigned int weight, std::deque<Event> &&events, CoalescedEvents &&coalescedEvents)
+{
+    // the carried events are not dropped by the queue size
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    auto& child = mChildEObjects[eObjectId];
+    child = {++mEObjectGeneration, 0, 0, 0};
+    if(weight != 1)
+        mEObjectQueues[eObjectId].weight = weight;
+    mCoalescedEvents.merge(coalescedEvents);
+    for(auto& event : events)
+    {
+        event.generation = child.generation;
+        enqueueEvent(std::move(event));
+    }
+    child.nQueuedEvents = events.size();
+    mNQueuedEvents += events.size();
+    mMaxEventQueueDepth = std::max(mMaxEventQueueDepth, eventQueueDepth());
+    if(events.empty())
+        return;
+    if(mIsEventDriven)
+        mEventQueueCondition.notify_one();
+    if(mIsEpollWaiting)
+        wakeEpoll();
+}
+
+void ethr::EThread::eraseChildEObject(int eObjectId, std::deque<Event> &removedEvents)
+{
+    // the queued events are taken out now rather than skipped on dispatch, so that a stopped EThread does not keep them
+    size_t nCurrentEvents = 0;
+    auto childIter = mChildEObjects.find(eObjectId);
+    if(childIter != mChildEObjects.end())
+    {
+        nCurrentEvents = childIter->second.nQueuedEvents;
+        mChildEObjects.erase(childIter);
+    }
+    size_t nRemovedBefore = removedEvents.size();
+    if((nCurrentEvents > 0 || mNStaleEvents > 0) && !mEventQueue.empty())
+    {
+        std::deque<Event> remainingEvents;
+        for(auto& event : mEventQueue)
+        {
+            if(event.eObjectId == eObjectId)
+                removedEvents.push_back(std::move(event));
+            else
+                remainingEvents.push_back(std::move(event));
+        }
+        mEventQueue.swap(remainingEvents);
+    }
+    // an emptied queue left in the round robin is dropped by popEvent()
+    auto eObjectQueueIter = mEObjectQueues.find(eObjectId);
+    if(eObjectQueueIter != mEObjectQueues.end())
+    {
+        auto& queue = eObjectQueueIter->second;
+        queue.weight = 1;
+        mNEObjectQueueEvents -= queue.events.size();
+        std::move(queue.events.begin(), queue.events.end(), std::back_inserter(removedEvents));
+        queue.events.clear();
+    }
+    // the events of earlier generations were counted as stale
+    mNStaleEvents -= removedEvents.size() - nRemovedBefore - nCurrentEvents;
+    eraseEObjectQueueIfUnused(eObjectId);
+    mCoalescedEvents.erase(mCoalescedEvents.lower_bound({eObjectId, std::string()}),
+                           mCoalescedEvents.lower_bound({eObjectId + 1, std::string()}));
+    std::erase_if(mFdWatches, [&](const auto& pair)
+    {
+        if(pair.second.eObjectId != eObjectId)
+            return false;
+#ifdef __linux__
+        epoll_ctl(mEpollFd, EPOLL_CTL_DEL, pair.first, nullptr);
+#endif
+        return true;
+    });
 }
 
 ethr::EThread & ethr::EThread::mainThread()
@@ -264,12 +1529,128 @@ void ethr::EThread::provideMainThread(ethr::EThread &ethread)
 
 void ethr::EThread::waitForEventHandleCompletion()
 {
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    mIdleCondition.wait(lock, [this]{ return isIdle(); });
+}
+
+bool ethr::EThread::waitForQuiescence(const std::vector<EThread*> &ethreads, std::chrono::nanoseconds timeout)
+{
+    bool isTimed = timeout != std::chrono::nanoseconds::max();
+    auto deadline = std::chrono::high_resolution_clock::now() + (isTimed ? timeout : std::chrono::nanoseconds(0));
+    std::vector<uint64_t> nQueuedEvents(ethreads.size());
     while(true)
     {
-        std::unique_lock<std::mutex> lock(mMutexEventQueue);
-        if(mEventQueue.empty())
-            return;
-        lock.unlock();
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        for(size_t i=0; i<ethreads.size(); i++)
+        {
+            EThread &ethread = *ethreads[i];
+            std::unique_lock<std::mutex> lock(ethread.mMutexEventQueue);
+            auto isIdle = [&ethread]{ return ethread.isIdle(); };
+            if(!isTimed)
+                ethread.mIdleCondition.wait(lock, isIdle);
+            else if(!ethread.mIdleCondition.wait_until(lock, deadline, isIdle))
+                return false;
+            nQueuedEvents[i] = ethread.mNQueuedEvents;
+        }
+
+        // an EThread found idle may have got events from one found idle later. if none has got any since,
+        // every EThread was idle at the end of the first pass
+        bool isQuiescent = true;
+        for(size_t i=0; i<ethreads.size() && isQuiescent; i++)
+        {
+            std::unique_lock<std::mutex> lock(ethreads[i]->mMutexEventQueue);
+            isQuiescent = ethreads[i]->isIdle() && ethreads[i]->mNQueuedEvents == nQueuedEvents[i];
+        }
+        if(isQuiescent)
+            return true;
+    }
+}
+
+void ethr::EThread::setMetricsEnabled(const bool &enabled)
+{
+    if(checkLoopRunningSafe()) return;
+    mIsMetricsEnabled = enabled;
+}
+
+ethr::EThread::Metrics ethr::EThread::metrics()
+{
+    Metrics metrics;
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    metrics.nQueuedEvents = mNQueuedEvents;
+    metrics.nDroppedEvents = mNDroppedEvents;
+    metrics.eventQueueDepth = eventQueueDepth();
+    metrics.maxEventQueueDepth = mMaxEventQueueDepth;
+    lock.unlock();
+
+    metrics.nHandledEvents = mLoopMetrics.nHandledEvents.load(std::memory_order_relaxed);
+    metrics.nLoops = mLoopMetrics.nLoops.load(std::memory_order_relaxed);
+    metrics.nLoopOverruns = mLoopMetrics.nLoopOverruns.load(std::memory_order_relaxed);
+    metrics.nBudgetExhaustions = mLoopMetrics.nBudgetExhaustions.load(std::memory_order_relaxed);
+    metrics.busyTime = std::chrono::nanoseconds(mLoopMetrics.busyTimeNs.load(std::memory_order_relaxed));
+    metrics.elapsedTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now().time_since_epoch())
+            - std::chrono::nanoseconds(mLoopMetrics.startTimeNs.load(std::memory_order_relaxed));
+    metrics.queueLatency = mLoopMetrics.queueLatency.snapshot();
+    metrics.handleLatency = mLoopMetrics.handleLatency.snapshot();
+    metrics.taskLatency = mLoopMetrics.taskLatency.snapshot();
+    return metrics;
+}
+
+void ethr::EThread::resetMetrics()
+{
+    std::unique_lock<std::mutex> lock(mMutexEventQueue);
+    mNQueuedEvents = 0;
+    mNDroppedEvents = 0;
+    mMaxEventQueueDepth = eventQueueDepth();
+    lock.unlock();
+
+    // the loop metrics have a single writer, so a running loop resets them itself
+    if(checkLoopRunningSafe() && currentEThreadPtr != this)
+    {
+        mLoopMetrics.isResetRequested.store(true, std::memory_order_release);
+        return;
+    }
+    resetLoopMetrics();
+}
+
+void ethr::EThread::resetLoopMetrics()
+{
+    mLoopMetrics.isResetRequested.store(false, std::memory_order_relaxed);
+    mLoopMetrics.nHandledEvents.store(0, std::memory_order_relaxed);
+    mLoopMetrics.nLoops.store(0, std::memory_order_relaxed);
+    mLoopMetrics.nLoopOverruns.store(0, std::memory_order_relaxed);
+    mLoopMetrics.nBudgetExhaustions.store(0, std::memory_order_relaxed);
+    mLoopMetrics.busyTimeNs.store(0, std::memory_order_relaxed);
+    mLoopMetrics.startTimeNs.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+    mLoopMetrics.queueLatency.reset();
+    mLoopMetrics.handleLatency.reset();
+    mLoopMetrics.taskLatency.reset();
+}
+
+void ethr::EThread::setSlowEventWatchdog(std::chrono::nanoseconds budget,
+                                         const std::function<void(const SlowEventReport&)> &callback,
+                                         const bool &captureStack)
+{
+    if(checkLoopRunningSafe()) return;
+    mSlowEventBudget = budget;
+    mSlowEventCallback = callback;
+    mIsSlowEventStackCaptured = captureStack;
+}
+
+void ethr::EThread::reportSlowEvent(const int &eObjectId, const std::type_info *callable, const std::chrono::nanoseconds &elapsed)
+{
+    SlowEventReport report{mName, eObjectId, callable, elapsed, {}};
+    if(mStackSamplerPtr)
+        report.stack = mStackSamplerPtr->takeStack();
+
+    if(mSlowEventCallback)
+    {
+        mSlowEventCallback(report);
+        return;
     }
+    std::cerr<<"[EThread] EThread("<<mName<<") "
+        <<(callable ? "event of EObject(" + std::to_string(eObjectId) + ", " + callable->name() + ")" : std::string("task()"))
+        <<" took "<<elapsed.count()<<"ns, exceeding the budget of "<<mSlowEventBudget.count()<<"ns."<<std::endl;
+    for(const auto& frame : report.stack)
+        std::cerr<<"    "<<frame<<std::endl;
 }
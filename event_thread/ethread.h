@@ -10,7 +10,13 @@
 #include <chrono>
 #include <memory>
 #include <map>
+#include <unordered_map>
 #include <thread>
+#include <condition_variable>
+#include <optional>
+#include "emetrics.h"
+#include "etrace.h"
+#include "efuture.h"
 
 namespace ethr
 {
@@ -19,8 +25,13 @@ class EObject;
 template <class>
 class EObjectRef;
 class UntypedEObjectRef;
+template <class>
+class ECallBatch;
+template <typename>
+class EChannel;
 template<typename PromiseType, typename... ParamTypes>
 class EPromise;
+class ELoadBalancer;
 
 class EThread
 {
@@ -32,12 +43,87 @@ public:
         USER_CONTROLLED,
     };
 
+    enum class EventQueuePolicy
+    {
+        FIFO,   // events of all EObjects are handled in the order queued
+        FAIR,   // each EObject has its own queue, drained by deficit round robin on handler time
+    };
+
+    enum class StopMode
+    {
+        DISCARD,        // stop after the event in progress. queued events are discarded
+        DRAIN,          // handle every queued event, including the ones queued while draining, then stop
+        DRAIN_UNTIL,    // drain until the timeout, then discard the rest
+    };
+
     class MainEThreadNotAssignedException : public std::runtime_error
     {
     public:
         explicit MainEThreadNotAssignedException(const std::string& what) : std::runtime_error(what){}
     };
 
+    /**
+     * @brief Snapshot of the runtime metrics of an EThread.
+     */
+    struct Metrics
+    {
+        uint64_t nQueuedEvents;         // events accepted to the event queue
+        uint64_t nDroppedEvents;        // events dropped since the event queue was full
+        uint64_t nHandledEvents;
+        uint64_t nLoops;
+        uint64_t nLoopOverruns;         // loops that ended after the next loop time
+        uint64_t nBudgetExhaustions;    // event handlings that left events for the next loop due to the budget
+        size_t eventQueueDepth;
+        size_t maxEventQueueDepth;
+        std::chrono::nanoseconds busyTime;      // time spent in task() and event handlers
+        std::chrono::nanoseconds elapsedTime;   // time since start or the last resetMetrics()
+        ELatencyHistogram::Snapshot queueLatency;   // time events waited in the event queue
+        ELatencyHistogram::Snapshot handleLatency;  // time event handlers ran
+        ELatencyHistogram::Snapshot taskLatency;    // time task() ran
+
+        double utilization() const
+        {
+            return elapsedTime.count() == 0 ? 0.0 : (double)busyTime.count() / (double)elapsedTime.count();
+        }
+    };
+
+    /**
+     * @brief Statistics of a fixed-rate task.
+     */
+    struct FixedRateTaskStats
+    {
+        int id;
+        std::chrono::nanoseconds period;
+        uint64_t nRuns;
+        uint64_t nOverruns;         // runs that ended after the deadline of the next run
+        uint64_t nSkippedRuns;      // deadlines skipped after overruns
+        std::chrono::nanoseconds maxLateness;   // start of a run after its deadline
+        std::chrono::nanoseconds maxRunTime;
+    };
+
+    /**
+     * @brief Load of an EObject tracked with setEObjectLoadTracking().
+     */
+    struct EObjectLoad
+    {
+        int eObjectId;
+        std::chrono::nanoseconds handleTime;    // handler time since the last takeEObjectLoads()
+        uint64_t nHandledEvents;                // events handled since the last takeEObjectLoads()
+        size_t nQueuedEvents;
+    };
+
+    /**
+     * @brief Report of an event handler or task() that ran longer than the watchdog budget.
+     */
+    struct SlowEventReport
+    {
+        std::string threadName;
+        int eObjectId;                      // -1 for task()
+        const std::type_info *callable;     // nullptr for task()
+        std::chrono::nanoseconds elapsed;
+        std::vector<std::string> stack;     // sampled when the budget ran out. empty unless requested
+    };
+
     explicit EThread(const std::string &name = "unnamed");
 
     ~EThread();
@@ -54,6 +140,36 @@ public:
      */
     void stop();
 
+    /**
+     * @brief Stop thread with a policy for the queued events. task() is not called while draining.
+     * stop() without a mode leaves the queued events for the next start().
+     *
+     * @param drainTimeout time limit of DRAIN_UNTIL
+     * @return number of queued events discarded. 0 for the main EThread, whose loop stops after this returns.
+     */
+    size_t stop(StopMode mode, std::chrono::nanoseconds drainTimeout = std::chrono::nanoseconds(0));
+
+    /**
+     * @brief Startup or shutdown time of a group of EThreads.
+     */
+    struct LifecycleReport
+    {
+        std::chrono::nanoseconds totalTime;
+        // {name, time until the loop ran onStart() or the thread is joined}
+        std::vector<std::pair<std::string, std::chrono::nanoseconds>> threadTimes;
+    };
+
+    /**
+     * @brief Start EThreads together and wait until every loop has run onStart(). The main EThread cannot be in the group.
+     * EThreads already running are left as they are.
+     */
+    static LifecycleReport startAll(const std::vector<EThread*> &ethreads);
+
+    /**
+     * @brief Signal every EThread to stop before joining any, so that the loops wind down concurrently.
+     */
+    static LifecycleReport stopAll(const std::vector<EThread*> &ethreads);
+
     void setName(const std::string &name);
 
     /**
@@ -80,13 +196,178 @@ public:
      */
     void setEventHandleScheme(EventHandleScheme scheme);
 
+    /**
+     * @brief Wake the loop up as soon as an event is queued instead of waiting for the next loop time.
+     * Events queued between loop times are handled right away, and task() still runs at the loop period.
+     * With the loop period of 0, the loop blocks until an event is queued and runs task() on every wake-up.
+     * Not applied to USER_CONTROLLED scheme.
+     *
+     * @param eventDriven
+     */
+    void setEventDriven(const bool &eventDriven);
+
+    /**
+     * @brief Pin the loop thread to a CPU core. Applied on start. Supported on Linux.
+     *
+     * @param cpu index of the core. -1 for no pinning.
+     */
+    void setCpuAffinity(const int &cpu);
+
+    /**
+     * @brief Wait for the loop time in epoll_wait() so that the thread can serve file descriptors with watchFd().
+     * Queued events wake the loop up as in an event-driven loop. Linux only.
+     *
+     * @param enabled
+     */
+    void setEpollEnabled(const bool &enabled);
+
+    /**
+     * @brief Call back an EObject in this thread when a file descriptor is ready. Requires setEpollEnabled(true).
+     * The readiness is queued as an event of the EObject, and the fd is not reported again until the callback returns.
+     * The fd is unwatched when the EObject is removed from this thread.
+     *
+     * @param eObject EObject in this thread
+     * @param fd
+     * @param events epoll events to watch, such as EPOLLIN and EPOLLOUT
+     * @param callback called with the ready epoll events
+     */
+    void watchFd(const EObject &eObject, int fd, uint32_t events, std::function<void(uint32_t)> &&callback);
+
+    void unwatchFd(int fd);
+
+    /**
+     * @brief Limit the work of an event handling so that a burst of events does not delay task().
+     * Events over the budget are left in the queue for the next loop.
+     *
+     * @param maxEvents maximum number of events handled at once. 0 for no limit.
+     * @param maxTime time after which no more events are started. 0 for no limit.
+     */
+    void setEventHandleBudget(const size_t &maxEvents, const std::chrono::nanoseconds &maxTime = std::chrono::nanoseconds(0));
+
+    /**
+     * @brief Set how events of the EObjects sharing this thread are ordered.
+     * With FAIR, an EObject flooding the thread with events does not delay the events of the other EObjects.
+     * Each EObject with queued events takes turns, handling events until its handler time exceeds quantum x weight.
+     *
+     * @param policy
+     * @param quantum handler time given to an EObject of weight 1 per turn. used by FAIR only.
+     */
+    void setEventQueuePolicy(EventQueuePolicy policy, const std::chrono::nanoseconds &quantum = std::chrono::microseconds(100));
+
+    /**
+     * @brief Set the share of handler time of an EObject under FAIR policy. The weight is 1 by default
+     * and reset when the EObject is removed from this thread.
+     *
+     * @param eObject EObject in this thread
+     * @param weight
+     */
+    void setEObjectWeight(const EObject &eObject, const unsigned int &weight);
+
+    /**
+     * @brief Set how deep EObject::callDirectOrQueued() calls may nest in this thread.
+     * Calls beyond the limit are queued, which bounds the stack use of call cycles.
+     *
+     * @param depth 0 queues every call.
+     */
+    void setDirectCallDepthLimit(const int &depth);
+
+    /**
+     * @brief Set the maximum number of events in the event queue. Events queued beyond it are dropped.
+     *
+     * @param size
+     */
+    void setEventQueueSize(const size_t &size);
+
+    /**
+     * @brief Enable or disable metric recording. Enabled by default.
+     *
+     * @param enabled
+     */
+    void setMetricsEnabled(const bool &enabled);
+
+    /**
+     * @brief Get a snapshot of the runtime metrics. Can be called from any thread.
+     */
+    Metrics metrics();
+
+    /**
+     * @brief Reset the metrics. Can be called from any thread.
+     * While the loop runs, the loop metrics are reset by the loop at the start of its next iteration.
+     */
+    void resetMetrics();
+
+    /**
+     * @brief Report event handlers and task() calls that run longer than the budget.
+     *
+     * @param budget zero disables the watchdog.
+     * @param callback called in this thread after the slow handler returns. reports to std::cerr if empty.
+     * @param captureStack sample the stack of the handler when it runs out of the budget. Linux only.
+     *  it arms a timer on every event, so it is costlier than the default check of elapsed time.
+     */
+    void setSlowEventWatchdog(std::chrono::nanoseconds budget,
+                              const std::function<void(const SlowEventReport&)> &callback = nullptr,
+                              const bool &captureStack = false);
+
     void handleQueuedEvents();
 
     void waitForEventHandleCompletion();
+
+    /**
+     * @brief Wait until none of the EThreads has a queued or running event at the same moment,
+     * so that no event is in flight between them.
+     *
+     * @return false on timeout
+     */
+    static bool waitForQuiescence(const std::vector<EThread*> &ethreads,
+                                  std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max());
     static void provideMainThread(EThread& ethread);
     static void stopMainThread();
     static EThread & mainThread();
 
+    /**
+     * @brief Run a callback at a fixed rate in the loop, besides task(). The fixed-rate tasks of an EThread are scheduled
+     * from one deadline queue, and run in the order of their deadlines. A run that ends past its next deadline skips
+     * the deadlines it missed instead of running back to back. Called before start().
+     *
+     * @param phase offset of the first run from the start of the loop
+     * @return id of the task
+     */
+    int addFixedRateTask(std::chrono::nanoseconds period, std::function<void()> &&callback,
+                         std::chrono::nanoseconds phase = std::chrono::nanoseconds(0));
+
+    /**
+     * @brief Remove a fixed-rate task. Called before start().
+     */
+    bool removeFixedRateTask(int id);
+
+    std::vector<FixedRateTaskStats> fixedRateTaskStats() const;
+
+    /**
+     * @brief Track the handler time of each EObject for takeEObjectLoads(). Called before start().
+     * Throws std::runtime_error if it changes the tracking of a running EThread.
+     */
+    void setEObjectLoadTracking(const bool &enabled);
+
+    /**
+     * @brief Get the load of each child EObject and restart the measurement.
+     */
+    std::vector<EObjectLoad> takeEObjectLoads();
+
+    /**
+     * @brief Move a child EObject to another EThread between two events of this thread, carrying its queued events over.
+     * Runs in the loop of this thread, or right away if the loop is not running. onMovedToThread() is not called,
+     * and EObjects watching file descriptors are not migrated.
+     * Call the EObject from other threads through EObjectRef, since EObject::callQueued() reads its EThread without a lock.
+     */
+    void migrateEObject(int eObjectId, EThread &target);
+
+    /**
+     * @brief Get the EThread running the loop on the calling thread.
+     *
+     * @return nullptr if called outside of an EThread loop.
+     */
+    static EThread * currentThread();
+
 protected:
     virtual void task()
     {};
@@ -98,38 +379,270 @@ protected:
     {};
 
 private:
+    struct Event
+    {
+        int eObjectId;
+        uint64_t generation;
+        std::function<void(void)> func;
+        std::chrono::high_resolution_clock::time_point queuedTime;
+        uint64_t traceId;   // 0 if not traced
+    };
+
+    // written by the loop thread only, so the hot path needs no lock nor read-modify-write
+    struct LoopMetrics
+    {
+        std::atomic<uint64_t> nHandledEvents;
+        std::atomic<uint64_t> nLoops;
+        std::atomic<uint64_t> nLoopOverruns;
+        std::atomic<uint64_t> nBudgetExhaustions;
+        std::atomic<int64_t> busyTimeNs;
+        std::atomic<int64_t> startTimeNs;
+        ELatencyHistogram queueLatency;
+        ELatencyHistogram handleLatency;
+        ELatencyHistogram taskLatency;
+        std::atomic<bool> isResetRequested;    // set by resetMetrics() while the loop runs
+    };
+
+    struct ChildEObject
+    {
+        uint64_t generation;
+        size_t nQueuedEvents;
+        int64_t handleTimeNs;       // tracked with mIsEObjectLoadTracked
+        uint64_t nHandledEvents;
+    };
+
+    struct FixedRateTask
+    {
+        std::chrono::nanoseconds period;
+        std::chrono::nanoseconds phase;
+        std::function<void()> callback;
+        // written by the loop thread only
+        std::atomic<uint64_t> nRuns;
+        std::atomic<uint64_t> nOverruns;
+        std::atomic<uint64_t> nSkippedRuns;
+        std::atomic<int64_t> maxLatenessNs;
+        std::atomic<int64_t> maxRunTimeNs;
+    };
+
+    using FixedRateDeadline = std::pair<std::chrono::high_resolution_clock::time_point, int>;   // {deadline, task id}
+
+    struct Migration
+    {
+        int eObjectId;
+        EThread *targetPtr;
+    };
+
+    // latest function of a coalesced event. the EThread holding it changes when its EObject is migrated
+    struct CoalescedEvent
+    {
+        std::function<void(void)> func;
+        EThread *ethreadPtr;
+    };
+    using CoalescedEvents = std::map<std::pair<int, std::string>, std::shared_ptr<CoalescedEvent>>;
+
+    // per-EObject event queue of FAIR policy
+    struct EObjectQueue
+    {
+        std::deque<Event> events;
+        unsigned int weight = 1;
+        int64_t deficitNs = 0;      // handler time left in the current turn
+        bool isTurnStarted = false;
+        bool isActive = false;      // in mActiveEObjectQueueIds
+    };
+
+    struct FdWatch
+    {
+        int eObjectId;
+        uint32_t events;
+        std::shared_ptr<std::function<void(uint32_t)>> callback;
+    };
+
+    struct StackSampler;
+
+    // leaves a direct call entered with enterDirectCall(). exception safe
+    struct DirectCallExit
+    {
+        ~DirectCallExit();
+    };
+
+    // the alignment also rounds the size of EThread up to whole lines, so nothing else shares the last line of the loop state
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    // configuration, written before start() and read-only while the loop runs
     std::thread mThread;
     bool mIsMain;
     std::string mName;
-    std::mutex
-        mMutexLoop,             // loop start, stop control
-        mMutexEventQueue,       // event queue
-        mMutexEventHandling,    // locked on event queue handling
-        mMutexChildObjects;     // child object list
-    std::deque<std::pair<int, std::function<void(void)>>> mEventQueue;
+    EventQueuePolicy mEventQueuePolicy;
+    std::chrono::nanoseconds mEventQueueQuantum;
+    EventHandleScheme mEventHandleScheme;
+    bool mIsEventDriven;
+    bool mIsMetricsEnabled;
+    bool mIsEObjectLoadTracked;
+    int mCpuAffinity;
+    int mDirectCallDepthLimit;
+    size_t mEventHandleBudgetCount;
+    std::chrono::nanoseconds mEventHandleBudgetTime;
+    std::chrono::nanoseconds mSlowEventBudget;
+    std::function<void(const SlowEventReport&)> mSlowEventCallback;
+    bool mIsSlowEventStackCaptured;
+    int mEpollFd;
+    int mEpollWakeFd;       // eventfd written on event push while the loop waits
+    int mEpollTimerFd;      // timerfd of the next loop time
+    static EThread* mainEThreadPtr;
+    static thread_local EThread* currentEThreadPtr;
+    static thread_local int directCallDepth;
+
+    // producer side, written on every event push. kept off the cache lines the loop reads on every iteration
+    alignas(CACHE_LINE_SIZE) std::mutex mMutexEventQueue;     // event queue, child object list
+    std::deque<Event> mEventQueue;
+    std::unordered_map<int, EObjectQueue> mEObjectQueues;
+    std::deque<int> mActiveEObjectQueueIds;     // EObjects with queued events in round robin order
+    size_t mNEObjectQueueEvents;                // total events in mEObjectQueues
+    // pending coalesced events of {eObjectId, key}. replaced in place until the queued event is handled.
+    CoalescedEvents mCoalescedEvents;
     size_t mEventQueueSize;
+    std::condition_variable mEventQueueCondition;  // notified with mMutexEventQueue on event push when event-driven
+    std::condition_variable mIdleCondition;        // notified with mMutexEventQueue when no event is queued nor running
+    std::optional<StopMode> mStopMode;              // set by stop() with a mode, applied by the loop on exit. guarded by mMutexEventQueue
+    std::chrono::high_resolution_clock::time_point mStopDrainDeadline;
+    // events queued before an EObject was removed or moved again have a stale generation, and are skipped on dispatch
+    std::unordered_map<int, ChildEObject> mChildEObjects;
+    uint64_t mEObjectGeneration;
+    size_t mNStaleEvents;   // events left in the queues by removed EObjects. not counted in the queue depth
+    std::vector<Migration> mPendingMigrations;  // guarded by mMutexEventQueue. run by the loop between events
+    bool mIsEpollWaiting;   // guarded by mMutexEventQueue
+    std::unordered_map<int, FdWatch> mFdWatches;    // guarded by mMutexEventQueue
+    size_t mNHandlingEvents;    // events popped from the event queue and being handled
+    // guarded by mMutexEventQueue
+    uint64_t mNQueuedEvents;
+    uint64_t mNDroppedEvents;
+    size_t mMaxEventQueueDepth;
+
+    // consumer side, touched by the loop on every iteration
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> mIsLoopRunning;
+    std::atomic<uint32_t> mLoopStartCount;     // bumped and notified after onStart()
     std::chrono::high_resolution_clock::duration mLoopPeriod;
     std::chrono::time_point<std::chrono::high_resolution_clock> mNextTaskTime;
-    bool mIsLoopRunning;
-    EventHandleScheme mEventHandleScheme;
-    std::vector<int> mChildEObjectsIds;
-    static EThread* mainEThreadPtr;
-    size_t mNEventQueueReservedForHandle;
+    size_t mNDiscardedOnStop;
+    std::map<int, FixedRateTask> mFixedRateTasks;   // changed only while the loop is not running
+    std::priority_queue<FixedRateDeadline, std::vector<FixedRateDeadline>, std::greater<>> mFixedRateDeadlines;
+    int mNextFixedRateTaskId;
+    std::unique_ptr<StackSampler> mStackSamplerPtr;
+    LoopMetrics mLoopMetrics;
+
+    bool checkLoopRunningSafe() const;
+
+    // sets the running flag and starts the loop. returns false if it was already running
+    bool launch();
+
+    // clears the running flag and wakes up the loop without joining it. returns false if it was not running
+    bool requestStop();
+
+    // drains or discards the queued events on loop exit as requested by stop()
+    void settleEventsOnStop();
+
+    // returns the number of discarded events
+    size_t discardQueuedEvents();
+
+    // mMutexEventQueue has to be locked. true if stop() asked to leave the remaining events
+    bool isStopDue() const;
+
+    // mMutexEventQueue has to be locked
+    bool isIdle() const;
+
+    // mMutexEventQueue has to be locked
+    void notifyIfIdle();
+
+    // mMutexEventQueue has to be locked
+    bool pushEvent(int eObjectId, ChildEObject &child, std::function<void()> &&func);
+
+    void runTask();
+
+    // called by the loop thread, or while the loop is not running
+    void resetLoopMetrics();
 
-    bool checkLoopRunningSafe();
+    std::chrono::nanoseconds handleEvent(Event &event);
+
+    size_t eventQueueDepth() const;
+
+    void enqueueEvent(Event &&event);
+
+    // mMutexEventQueue has to be locked. the skipped stale events are moved to staleEvents,
+    // so that the caller destroys them after unlocking
+    bool popEvent(Event &event, std::deque<Event> &staleEvents);
+
+    // updates the event counts of a popped event. returns false if the event is stale
+    bool acceptPoppedEvent(const Event &event);
+
+    void chargeEvent(int eObjectId, std::chrono::nanoseconds elapsed);
+
+    // drops the FAIR queue of an EObject that left this thread once no event of it is queued
+    void eraseEObjectQueueIfUnused(int eObjectId);
+
+    // returns false if woken up by a queued event or a fixed-rate task before the next loop time
+    bool waitForNextLoop();
+
+    // time the loop has to wake up at, the next loop time or the earliest fixed-rate deadline
+    std::chrono::high_resolution_clock::time_point nextWakeUpTime() const;
+
+    void scheduleFixedRateTasks(std::chrono::high_resolution_clock::time_point startTime);
+
+    void runFixedRateTasks();
+
+    void reportSlowEvent(const int &eObjectId, const std::type_info *callable, const std::chrono::nanoseconds &elapsed);
 
     void queueNewEvent(int eObjectId, std::function<void()> &&func);
 
+    void queueCoalescedEvent(int eObjectId, std::string &&key, std::function<void()> &&func);
+
+    void queueNewEvents(int eObjectId, std::vector<std::function<void()>> &&funcs);
+
     void runLoop();
 
     static void *threadEntryPoint(void *param);
 
+    bool waitForEpoll();
+
+    // mMutexEventQueue has to be locked
+    void queueFdEvent(int fd, uint32_t readyEvents);
+
+    void rearmFd(int fd, uint32_t events);
+
+    // mMutexEventQueue has to be locked
+    void wakeEpoll();
+
+    void closeEpoll();
+
+    // returns true if the calling thread runs this EThread and the direct call depth is under the limit
+    bool enterDirectCall();
+
     void addChildEObject(EObject *eObjectPtr);
 
     void removeChildEObject(EObject *eObjectPtr);
 
+    // takes mutexActiveEObjectIds exclusively. called by the loop between events
+    void runPendingMigrations();
+
+    // true until the loop has run or dropped the migration of the EObject
+    bool isMigrationPending(int eObjectId);
+
+    // mutexActiveEObjectIds and mMutexEventQueue have to be locked. the stale events left are moved to staleEvents
+    void migrateChildEObject(int eObjectId, EThread &target, std::deque<Event> &staleEvents);
+
+    // mutexActiveEObjectIds has to be locked exclusively
+    void adoptChildEObject(int eObjectId, unsigned int weight, std::deque<Event> &&events, CoalescedEvents &&coalescedEvents);
+
+    void addChildEObjects(const std::vector<EObject*> &eObjects);
+
+    void removeChildEObjects(const std::vector<EObject*> &eObjects);
+
+    // mMutexEventQueue has to be locked. the queued events of the EObject are moved to removedEvents
+    void eraseChildEObject(int eObjectId, std::deque<Event> &removedEvents);
+
     friend EObject;
     template <class> friend class EObjectRef;
+    template <class> friend class ECallBatch;
+    friend ELoadBalancer;
 };
 
 class EObject
@@ -163,6 +676,38 @@ public:
         mThreadInAffinity->queueNewEvent(mId, std::move(func));
     }
 
+    /**
+     * @brief Queue a call that replaces the pending call of the same member function, if any.
+     * Only the latest arguments survive, so the function runs once per event handling no matter how often it is posted.
+     */
+    template<typename RetType, typename ObjType, class... Args>
+    void callQueuedCoalesced(RetType (ObjType::*funcPtr)(Args...), Args... args)
+    {
+        if (mThreadInAffinity == nullptr)
+            throw std::runtime_error("EObject::callQueuedCoalesced() is called but no EThread is assigned to it.");
+        std::string key(reinterpret_cast<const char*>(&funcPtr), sizeof(funcPtr));
+        mThreadInAffinity->queueCoalescedEvent(mId, std::move(key), std::bind(funcPtr, (ObjType *) this, args...));
+    }
+
+    /**
+     * @brief Call the function right away if the caller runs in the EThread of this EObject, or queue it otherwise.
+     * Saves a queue round trip on hops between EObjects of the same EThread. A direct call is not ordered
+     * after the calls queued before it, and nested direct calls over EThread::setDirectCallDepthLimit() are queued.
+     */
+    template<typename RetType, typename ObjType, class... Args>
+    void callDirectOrQueued(RetType (ObjType::*funcPtr)(Args...), Args... args)
+    {
+        if (mThreadInAffinity == nullptr)
+            throw std::runtime_error("EObject::callDirectOrQueued() is called but no EThread is assigned to it.");
+        if (!mThreadInAffinity->enterDirectCall())
+        {
+            mThreadInAffinity->queueNewEvent(mId, std::bind(funcPtr, (ObjType *) this, args...));
+            return;
+        }
+        EThread::DirectCallExit directCallExit;
+        (((ObjType *) this)->*funcPtr)(args...);
+    }
+
     // no args version
     // !!USE REGULAR callQueued() INSTEAD!!
     /*
@@ -186,6 +731,18 @@ public:
 
     void removeFromThread();
 
+    /**
+     * @brief Move to another EThread between two events, carrying the queued events over. See EThread::migrateEObject().
+     */
+    void migrateToThread(EThread &ethread);
+
+    /**
+     * @brief Move EObjects to an EThread, taking the locks of each EThread once for the whole group.
+     */
+    static void moveToThread(const std::vector<EObject*> &eObjects, EThread &ethread);
+
+    static void removeFromThread(const std::vector<EObject*> &eObjects);
+
     UntypedEObjectRef uref();
 
     template <class T>
@@ -197,20 +754,31 @@ public:
                     ("[EThread] In EObject::ref(). Cannot create EObjectRef of type <" + std::string(typeid(T*).name()) + ">."));
         return EObjectRef<T>(mId, dynamic_cast<T*>(this));
     }
-    int id(){return mId;}
+
+    template <class T>
+    ECallBatch<T> batch()
+    {
+        return ECallBatch<T>(ref<T>());
+    }
+    int id() const {return mId;}
 protected:
     EThread * threadInAffinity();
+    // changes whenever the EObject is moved or removed. events queued before that are dropped
+    uint64_t affinityGeneration() const {return mAffinityGeneration;}
     virtual void onMovedToThread(EThread& ethread){};
     virtual void onRemovedFromThread(){};
 private:
     int mId;
     EThread *mThreadInAffinity;
+    std::atomic<uint64_t> mAffinityGeneration;
     static int idCount;
     static std::map<int, EObject*> activeEObjectIds;
     static std::shared_mutex mutexActiveEObjectIds;
 friend EThread;
 friend UntypedEObjectRef;
 template <class> friend class EObjectRef;
+template <class> friend class ECallBatch;
+template <typename> friend class EChannel;
 };
 
 class UntypedEObjectRef
@@ -248,6 +816,8 @@ private:
         mInitialized = true;
     }
 friend EObject;
+template <class> friend class ECallBatch;
+template <typename> friend class EChannel;
 };
 
 template <class EObjectType>
@@ -289,6 +859,98 @@ public:
         return true;
     }
 
+    template<typename RetType, class... Args>
+    bool callQueuedCoalesced(RetType (EObjectType::*funcPtr)(Args...), Args... args)
+    {
+        if(!mInitialized)
+            throw std::runtime_error("[EThread] EObjectRef::callQueuedCoalesced() is called on a empty reference.");
+        std::shared_lock<std::shared_mutex> lock(EObject::mutexActiveEObjectIds);
+        auto eObjectPtrIter = EObject::activeEObjectIds.find(mEObjectId);
+        if (eObjectPtrIter == EObject::activeEObjectIds.end())
+            return false;
+        eObjectPtrIter->second->callQueuedCoalesced(funcPtr, args...);
+        return true;
+    }
+
+    template<typename RetType, class... Args>
+    bool callDirectOrQueued(RetType (EObjectType::*funcPtr)(Args...), Args... args)
+    {
+        if(!mInitialized)
+            throw std::runtime_error("[EThread] EObjectRef::callDirectOrQueued() is called on a empty reference.");
+        std::shared_lock<std::shared_mutex> lock(EObject::mutexActiveEObjectIds);
+        auto eObjectPtrIter = EObject::activeEObjectIds.find(mEObjectId);
+        if (eObjectPtrIter == EObject::activeEObjectIds.end())
+            return false;
+        EObject* eObjectPtr = eObjectPtrIter->second;
+        if (!eObjectPtr->mThreadInAffinity->enterDirectCall())
+        {
+            eObjectPtr->callQueued(funcPtr, args...);
+            return true;
+        }
+        // the handler must not run under the lock since it may move EObjects or resolve other references
+        lock.unlock();
+        EThread::DirectCallExit directCallExit;
+        (((EObjectType *) eObjectPtr)->*funcPtr)(args...);
+        return true;
+    }
+
+    /**
+     * @brief Queue a call and get a future of its result. The future is fulfilled as soon as the handler returns,
+     * and holds the exception if the handler throws or the call is dropped.
+     * Called in the EThread of the target, the function runs right away so that waiting the future does not deadlock.
+     * A call to a stopped EThread is kept queued like other events, and the future waits for the next start().
+     */
+    template<typename RetType, class... Args>
+    EFuture<RetType> callAsync(RetType (EObjectType::*funcPtr)(Args...), Args... args)
+    {
+        if(!mInitialized)
+            throw std::runtime_error("[EThread] EObjectRef::callAsync() is called on a empty reference.");
+        auto [future, resolverPtr] = EFuture<RetType>::create();
+        std::shared_lock<std::shared_mutex> lock(EObject::mutexActiveEObjectIds);
+        auto eObjectPtrIter = EObject::activeEObjectIds.find(mEObjectId);
+        if (eObjectPtrIter == EObject::activeEObjectIds.end())
+            return future;
+        auto* eObjectPtr = (EObjectType*)eObjectPtrIter->second;
+        if (EThread::currentThread() == eObjectPtr->mThreadInAffinity)
+        {
+            lock.unlock();
+            resolverPtr->run([&]{ return (eObjectPtr->*funcPtr)(args...); });
+            return future;
+        }
+        eObjectPtr->mThreadInAffinity->queueNewEvent(mEObjectId, [=]
+        {
+            resolverPtr->run([&]{ return (eObjectPtr->*funcPtr)(args...); });
+        });
+        return future;
+    }
+
+    /**
+     * @brief Call and wait for the result. Throws what the handler throws, or std::runtime_error if the call is dropped.
+     * Blocks until the target EThread is started if it is stopped. Use callAsync() and EFuture::waitFor() to bound the wait.
+     */
+    template<typename RetType, class... Args>
+    RetType callBlocking(RetType (EObjectType::*funcPtr)(Args...), Args... args)
+    {
+        return callAsync(funcPtr, args...).get();
+    }
+
+    /**
+     * @brief Post a typed message to an EMessageObject.
+     *
+     * @return false if the EObject is gone or its message queue is full
+     */
+    template<typename MessageType>
+    bool post(MessageType &&message)
+    {
+        if(!mInitialized)
+            throw std::runtime_error("[EThread] EObjectRef::post() is called on a empty reference.");
+        std::shared_lock<std::shared_mutex> lock(EObject::mutexActiveEObjectIds);
+        auto eObjectPtrIter = EObject::activeEObjectIds.find(mEObjectId);
+        if (eObjectPtrIter == EObject::activeEObjectIds.end())
+            return false;
+        return ((EObjectType*)eObjectPtrIter->second)->post(std::forward<MessageType>(message));
+    }
+
     // no args version
     template<typename RetType>
     bool callQueuedMove(RetType (EObjectType::*funcPtr)())
@@ -312,6 +974,11 @@ public:
         EObjectRef<T> ref(mEObjectId, castedEObjectPtr);
         return ref;
     }
+    ECallBatch<EObjectType> batch() const
+    {
+        return ECallBatch<EObjectType>(*this);
+    }
+
     EObjectType * eObjectUnsafePtr() const {return mEObjectUnsafePtr;}
 private:
 
@@ -319,5 +986,61 @@ private:
     friend EObject;
 };
 
+/**
+ * @brief Accumulates calls to an EObject locally and posts them to its EThread at once.
+ * The calls are queued back to back with a single lock on the target event queue.
+ */
+template <class EObjectType>
+class ECallBatch
+{
+public:
+    explicit ECallBatch(const EObjectRef<EObjectType> &eObjectRef)
+    {
+        if(!eObjectRef.isInitialized())
+            throw std::runtime_error("[EThread] ECallBatch is created using empty EObject reference.");
+        mEObjectRef = eObjectRef;
+    }
+
+    template<typename RetType, class... Args>
+    ECallBatch& callQueued(RetType (EObjectType::*funcPtr)(Args...), Args... args)
+    {
+        mFuncs.emplace_back(std::bind(funcPtr, mEObjectRef.eObjectUnsafePtr(), args...));
+        return *this;
+    }
+
+    template<typename RetType, class... Args>
+    ECallBatch& callQueuedMove(RetType (EObjectType::*funcPtr)(Args&&...), Args&&... args)
+    {
+        auto eObjectPtr = mEObjectRef.eObjectUnsafePtr();
+        mFuncs.emplace_back([=, ... args = std::move(args)]()mutable{(eObjectPtr->*funcPtr)(std::move(args)...);});
+        return *this;
+    }
+
+    void reserve(const size_t &size){mFuncs.reserve(size);}
+    size_t size() const {return mFuncs.size();}
+
+    /**
+     * @brief Post accumulated calls to the target EObject and clear the batch.
+     *
+     * @return false if the target EObject is not in a thread.
+     */
+    bool post()
+    {
+        std::shared_lock<std::shared_mutex> lock(EObject::mutexActiveEObjectIds);
+        auto eObjectPtrIter = EObject::activeEObjectIds.find(mEObjectRef.mEObjectId);
+        if (eObjectPtrIter == EObject::activeEObjectIds.end())
+        {
+            mFuncs.clear();
+            return false;
+        }
+        eObjectPtrIter->second->mThreadInAffinity->queueNewEvents(mEObjectRef.mEObjectId, std::move(mFuncs));
+        mFuncs.clear();
+        return true;
+    }
+private:
+    EObjectRef<EObjectType> mEObjectRef;
+    std::vector<std::function<void(void)>> mFuncs;
+};
+
 }
 #endif
@@ -0,0 +1,200 @@
+#include "etrace.h"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <memory>
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#endif
+
+namespace
+{
+thread_local std::string threadName;
+
+int64_t toNs(const ethr::ETracer::TimePoint &timePoint)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(timePoint.time_since_epoch()).count();
+}
+
+std::string demangle(const char *name)
+{
+#if __has_include(<cxxabi.h>)
+    int status = 0;
+    std::unique_ptr<char, void(*)(void*)> demangled(abi::__cxa_demangle(name, nullptr, nullptr, &status), std::free);
+    if(status == 0 && demangled)
+        return demangled.get();
+#endif
+    return name;
+}
+
+std::string escapeJson(const std::string &str)
+{
+    std::string escaped;
+    for(char c : str)
+    {
+        if(c == '"' || c == '\\')
+            escaped += '\\';
+        if((unsigned char)c >= 0x20)
+            escaped += c;
+    }
+    return escaped;
+}
+
+// chrome trace timestamps are in microseconds
+std::string toUs(const int64_t &ns)
+{
+    int64_t absNs = ns < 0 ? -ns : ns;
+    return (ns < 0 ? "-" : "") + std::to_string(absNs / 1000) + "." + std::to_string(1000 + absNs % 1000).substr(1);
+}
+}
+
+std::mutex &ethr::ETracer::mutexThreadBuffers()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::vector<ethr::ETracer::ThreadBuffer*> &ethr::ETracer::threadBuffers()
+{
+    // buffers are never freed so that records of exited threads can still be dumped
+    static std::vector<ThreadBuffer*> buffers;
+    return buffers;
+}
+
+ethr::ETracer::ThreadBuffer *&ethr::ETracer::threadBufferPtr()
+{
+    thread_local ThreadBuffer *bufferPtr = nullptr;
+    return bufferPtr;
+}
+
+ethr::ETracer::ThreadBuffer &ethr::ETracer::threadBuffer()
+{
+    ThreadBuffer *&bufferPtr = threadBufferPtr();
+    if(bufferPtr)
+        return *bufferPtr;
+
+    std::unique_lock<std::mutex> lock(mutexThreadBuffers());
+    bufferPtr = new ThreadBuffer;
+    bufferPtr->tid = (int)threadBuffers().size() + 1;
+    bufferPtr->name = threadName.empty() ? "thread " + std::to_string(bufferPtr->tid) : threadName;
+    bufferPtr->records.resize(nRecordsPerThread.load());
+    bufferPtr->nRecords = 0;
+    threadBuffers().push_back(bufferPtr);
+    return *bufferPtr;
+}
+
+void ethr::ETracer::record(const Record &record)
+{
+    ThreadBuffer &buffer = threadBuffer();
+    uint64_t nRecords = buffer.nRecords.load(std::memory_order_relaxed);
+    buffer.records[nRecords % buffer.records.size()] = record;
+    buffer.nRecords.store(nRecords + 1, std::memory_order_release);
+}
+
+void ethr::ETracer::start(const size_t &nRecords)
+{
+    if(nRecords == 0)
+        throw std::runtime_error("[EThread] ETracer::start() is called with zero records per thread.");
+    nRecordsPerThread = nRecords;
+    isTracingFlag = true;
+}
+
+void ethr::ETracer::stop()
+{
+    isTracingFlag = false;
+}
+
+void ethr::ETracer::clear()
+{
+    std::unique_lock<std::mutex> lock(mutexThreadBuffers());
+    for(auto bufferPtr : threadBuffers())
+        bufferPtr->nRecords = 0;
+}
+
+void ethr::ETracer::setThreadName(const std::string &name)
+{
+    threadName = name;
+    if(threadBufferPtr())
+    {
+        std::unique_lock<std::mutex> lock(mutexThreadBuffers());
+        threadBufferPtr()->name = name;
+    }
+}
+
+uint64_t ethr::ETracer::recordQueued(const int &eObjectId)
+{
+    uint64_t eventId = eventIdCount.fetch_add(1, std::memory_order_relaxed) + 1;
+    int64_t nowNs = toNs(std::chrono::high_resolution_clock::now());
+    record({RecordType::QUEUED, eObjectId, eventId, nullptr, nowNs, nowNs, nowNs});
+    return eventId;
+}
+
+void ethr::ETracer::recordHandled(const uint64_t &eventId, const int &eObjectId, const std::type_info &callable,
+                                  const TimePoint &queuedTime, const TimePoint &startTime, const TimePoint &endTime)
+{
+    record({RecordType::HANDLED, eObjectId, eventId, &callable, toNs(queuedTime), toNs(startTime), toNs(endTime)});
+}
+
+void ethr::ETracer::recordTask(const TimePoint &startTime, const TimePoint &endTime)
+{
+    record({RecordType::TASK, -1, 0, nullptr, toNs(startTime), toNs(startTime), toNs(endTime)});
+}
+
+void ethr::ETracer::dump(std::ostream &ostream)
+{
+    std::unique_lock<std::mutex> lock(mutexThreadBuffers());
+    ostream<<"{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool isFirst = true;
+    auto beginEvent = [&]()->std::ostream&
+    {
+        ostream<<(isFirst ? "\n" : ",\n");
+        isFirst = false;
+        return ostream;
+    };
+
+    for(auto bufferPtr : threadBuffers())
+    {
+        const std::string tid = std::to_string(bufferPtr->tid);
+        beginEvent()<<R"({"name":"thread_name","ph":"M","pid":1,"tid":)"<<tid
+            <<R"(,"args":{"name":")"<<escapeJson(bufferPtr->name)<<"\"}}";
+
+        uint64_t nRecords = bufferPtr->nRecords.load(std::memory_order_acquire);
+        uint64_t nKept = std::min<uint64_t>(nRecords, bufferPtr->records.size());
+        for(uint64_t i = nRecords - nKept; i < nRecords; i++)
+        {
+            const Record &record = bufferPtr->records[i % bufferPtr->records.size()];
+            switch(record.type)
+            {
+            case RecordType::QUEUED:
+                beginEvent()<<R"({"name":"queue","cat":"event","ph":"s","id":)"<<record.eventId
+                    <<R"(,"pid":1,"tid":)"<<tid<<R"(,"ts":)"<<toUs(record.startTimeNs)<<"}";
+                break;
+            case RecordType::HANDLED:
+                beginEvent()<<R"({"name":")"<<escapeJson(demangle(record.callable->name()))
+                    <<R"(","cat":"event","ph":"X","pid":1,"tid":)"<<tid
+                    <<R"(,"ts":)"<<toUs(record.startTimeNs)
+                    <<R"(,"dur":)"<<toUs(record.endTimeNs - record.startTimeNs)
+                    <<R"(,"args":{"eObjectId":)"<<record.eObjectId
+                    <<R"(,"queueDelayUs":)"<<toUs(record.startTimeNs - record.queuedTimeNs)<<"}}";
+                beginEvent()<<R"({"name":"queue","cat":"event","ph":"f","bp":"e","id":)"<<record.eventId
+                    <<R"(,"pid":1,"tid":)"<<tid<<R"(,"ts":)"<<toUs(record.startTimeNs)<<"}";
+                break;
+            case RecordType::TASK:
+                beginEvent()<<R"({"name":"task","cat":"task","ph":"X","pid":1,"tid":)"<<tid
+                    <<R"(,"ts":)"<<toUs(record.startTimeNs)
+                    <<R"(,"dur":)"<<toUs(record.endTimeNs - record.startTimeNs)<<"}";
+                break;
+            }
+        }
+    }
+    ostream<<"\n]}\n";
+}
+
+bool ethr::ETracer::dump(const std::string &filePath)
+{
+    std::ofstream file(filePath);
+    if(!file.is_open())
+        return false;
+    dump(file);
+    return file.good();
+}
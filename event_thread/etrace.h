@@ -0,0 +1,102 @@
+#ifndef EVENT_THREAD_ETRACE_H
+#define EVENT_THREAD_ETRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+namespace ethr
+{
+
+/**
+ * @brief Opt-in tracer of EThread events that exports Chrome trace JSON, which can be opened in Perfetto or chrome://tracing.
+ * Each thread records into its own lock-free ring buffer. The oldest records are overwritten when it is full.
+ */
+class ETracer
+{
+public:
+    /**
+     * @brief Start tracing.
+     *
+     * @param nRecordsPerThread ring buffer size of each thread. Applied to threads that record for the first time.
+     */
+    static void start(const size_t &nRecordsPerThread = 1 << 16);
+
+    static void stop();
+
+    static bool isTracing()
+    {
+        return isTracingFlag.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Discard recorded events.
+     */
+    static void clear();
+
+    /**
+     * @brief Write recorded events in Chrome trace JSON. Call it after stop().
+     */
+    static void dump(std::ostream &ostream);
+
+    static bool dump(const std::string &filePath);
+
+    /**
+     * @brief Name the calling thread in the trace. EThread names its loop thread automatically.
+     */
+    static void setThreadName(const std::string &name);
+
+    using TimePoint = std::chrono::high_resolution_clock::time_point;
+
+    // called by EThread
+    static uint64_t recordQueued(const int &eObjectId);
+    static void recordHandled(const uint64_t &eventId, const int &eObjectId, const std::type_info &callable,
+                              const TimePoint &queuedTime, const TimePoint &startTime, const TimePoint &endTime);
+    static void recordTask(const TimePoint &startTime, const TimePoint &endTime);
+
+private:
+    enum class RecordType : uint8_t
+    {
+        QUEUED,
+        HANDLED,
+        TASK,
+    };
+
+    struct Record
+    {
+        RecordType type;
+        int eObjectId;
+        uint64_t eventId;
+        const std::type_info *callable;
+        int64_t queuedTimeNs;
+        int64_t startTimeNs;
+        int64_t endTimeNs;
+    };
+
+    struct ThreadBuffer
+    {
+        int tid;
+        std::string name;
+        std::vector<Record> records;
+        std::atomic<uint64_t> nRecords;   // written by the owner thread only
+    };
+
+    static inline std::atomic<bool> isTracingFlag{false};
+    static inline std::atomic<uint64_t> eventIdCount{0};
+    static inline std::atomic<size_t> nRecordsPerThread{1 << 16};
+
+    static std::mutex &mutexThreadBuffers();
+    static std::vector<ThreadBuffer*> &threadBuffers();
+    static ThreadBuffer *&threadBufferPtr();
+    static ThreadBuffer &threadBuffer();
+    static void record(const Record &record);
+};
+
+}
+
+#endif
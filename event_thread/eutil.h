@@ -2,6 +2,10 @@
 #define EVENT_THREAD_UTIL_H
 
 #include "ethread.h"
+#include <atomic>
+#include <optional>
+#include <unordered_map>
+#include <algorithm>
 
 namespace ethr
 {
@@ -42,6 +46,349 @@ private:
     std::shared_ptr<std::shared_mutex> mMutexPtr;
 };
 
+/**
+ * @brief Read-copy-update sibling of SafeSharedPtr for data that is read often and written rarely.
+ * Readers get an immutable snapshot without taking a lock, and writers publish a modified copy.
+ * A snapshot is reclaimed when its last reader releases it. Each thread caches the snapshot it read last
+ * from each RcuSharedPtr, so it is kept alive until the thread reads that one again or exits.
+ */
+template<typename T>
+class RcuSharedPtr
+{
+public:
+    // a reference to the cached snapshot, so that passing it to manip does not touch the reference count
+    using ReadOnlyPtr = const std::shared_ptr<const T>&;
+    using ReadWritePtr = const std::shared_ptr<T>;
+    // constructor
+    RcuSharedPtr();
+    explicit RcuSharedPtr(std::shared_ptr<T> var);
+    // copy constructor
+    RcuSharedPtr(const RcuSharedPtr &rcuSharedPtr);
+
+    /**
+     * @brief Get a reference-counted copy of the latest snapshot. It stays valid and unchanged while it is held.
+     * Prefer readOnly(), which does not touch the reference count shared by the readers.
+     */
+    std::shared_ptr<const T> snapshot() const
+    {
+        ReadCache *cachePtr = cachedSnapshot();
+        if(cachePtr == nullptr)
+            return std::atomic_load_explicit(&mStatePtr->snapshot, std::memory_order_acquire);
+        return cachePtr->snapshot;
+    }
+
+    // manip runs outside any critical section. writers never wait for it.
+    // manip gets the snapshot cached by this thread, so a read of an unchanged snapshot writes to no shared memory
+    template<typename Manip>
+    // functor template avoids reallocation. Manip has to be the type: void(ReadOnlyPtr)
+    void readOnly(Manip manip) const
+    {
+        ReadCache *cachePtr = cachedSnapshot();
+        if(cachePtr == nullptr)
+        {
+            // nested in a read of an outdated snapshot, which the outer manip keeps using
+            const std::shared_ptr<const T> latest = std::atomic_load_explicit(&mStatePtr->snapshot, std::memory_order_acquire);
+            manip(latest);
+            return;
+        }
+        cachePtr->nReaders++;
+        try
+        {
+            manip(cachePtr->snapshot);
+        }
+        catch(...)
+        {
+            cachePtr->nReaders--;
+            throw;
+        }
+        cachePtr->nReaders--;
+    }
+
+    // manip modifies a copy of the latest snapshot, which is published afterwards. writers are serialized
+    template<typename Manip>
+    // functor template avoids reallocation. Manip has to be the type: void(ReadWritePtr)
+    void readWrite(Manip manip)
+    {
+        std::unique_lock lock(mStatePtr->mutexWrite);
+        auto current = std::atomic_load_explicit(&mStatePtr->snapshot, std::memory_order_acquire);
+        std::shared_ptr<T> copied = current ? std::make_shared<T>(*current) : nullptr;
+        manip(copied);
+        std::atomic_store_explicit(&mStatePtr->snapshot, std::shared_ptr<const T>(copied), std::memory_order_release);
+        mStatePtr->version.store(versionCount.fetch_add(1) + 1, std::memory_order_release);
+    }
+
+private:
+    struct State
+    {
+        std::shared_ptr<const T> snapshot;
+        std::atomic<uint64_t> version;
+        std::mutex mutexWrite;
+    };
+    struct ReadCache
+    {
+        std::weak_ptr<State> stateWeakPtr;     // only checked when pruning
+        uint64_t version = 0;
+        int nReaders = 0;
+        std::shared_ptr<const T> snapshot;
+    };
+    // entries of the RcuSharedPtrs read by a thread. entries are nodes, so references to them survive insertions
+    using ReadCaches = std::unordered_map<const State*, ReadCache>;
+    static constexpr size_t READ_CACHE_PRUNE_SIZE = 64;
+
+    // returns nullptr if the entry is outdated but still used by an outer read of this thread
+    ReadCache *cachedSnapshot() const
+    {
+        // the version is only written on publish, so reading it keeps its cache line shared among the readers
+        uint64_t version = mStatePtr->version.load(std::memory_order_acquire);
+        ReadCache *lastCachePtr = lastReadCachePtr;
+        if(lastCachePtr != nullptr && lastReadStatePtr == mStatePtr.get() && lastCachePtr->version == version)
+            return lastCachePtr;
+        ReadCaches &caches = readCaches;
+        auto cacheIter = caches.find(mStatePtr.get());
+        if(cacheIter != caches.end() && cacheIter->second.version == version)
+        {
+            lastReadStatePtr = mStatePtr.get();
+            lastReadCachePtr = &cacheIter->second;
+            return lastReadCachePtr;
+        }
+
+        if(cacheIter == caches.end())
+        {
+            if(caches.size() >= READ_CACHE_PRUNE_SIZE)
+                pruneReadCaches(caches);
+            cacheIter = caches.emplace(mStatePtr.get(), ReadCache()).first;
+        }
+        ReadCache &cache = cacheIter->second;
+        if(cache.nReaders > 0)
+            return nullptr;
+        // a State reallocated at the same address has a new version, so its entry is refreshed here
+        if(cache.stateWeakPtr.expired())
+            cache.stateWeakPtr = mStatePtr;
+        cache.snapshot = std::atomic_load_explicit(&mStatePtr->snapshot, std::memory_order_acquire);
+        cache.version = version;
+        lastReadStatePtr = mStatePtr.get();
+        lastReadCachePtr = &cache;
+        return &cache;
+    }
+
+    // drops the entries of destroyed RcuSharedPtrs so that their last snapshots are released
+    static void pruneReadCaches(ReadCaches &caches)
+    {
+        for(auto cacheIter = caches.begin(); cacheIter != caches.end();)
+        {
+            if(cacheIter->second.nReaders == 0 && cacheIter->second.stateWeakPtr.expired())
+            {
+                if(lastReadCachePtr == &cacheIter->second)
+                    lastReadCachePtr = nullptr;
+                cacheIter = caches.erase(cacheIter);
+            }
+            else
+                ++cacheIter;
+        }
+    }
+
+    std::shared_ptr<State> mStatePtr;
+    // versions are unique among all RcuSharedPtr<T> so a cache entry never matches a reallocated state
+    static std::atomic<uint64_t> versionCount;
+    static thread_local ReadCaches readCaches;
+    // entry of the last read, which skips the lookup when a thread keeps reading the same RcuSharedPtr
+    static thread_local const State *lastReadStatePtr;
+    static thread_local ReadCache *lastReadCachePtr;
+};
+
+/**
+ * @brief SafeSharedPtr split into stripes selected by a key hash.
+ * Accesses to different stripes proceed in parallel.
+ */
+template<typename T>
+class StripedSafeSharedPtr
+{
+public:
+    using ReadOnlyPtr = typename SafeSharedPtr<T>::ReadOnlyPtr;
+    using ReadWritePtr = typename SafeSharedPtr<T>::ReadWritePtr;
+
+    explicit StripedSafeSharedPtr(const size_t &nStripes = 16)
+    {
+        if(nStripes == 0)
+            throw std::runtime_error("[EThread] StripedSafeSharedPtr is created with zero stripes.");
+        for(size_t i=0; i<nStripes; i++)
+            mStripes.emplace_back(std::make_shared<T>());
+    }
+
+    size_t stripeCount() const {return mStripes.size();}
+
+    size_t stripeIndex(const size_t &hash) const
+    {
+        // mix the hash since std::hash of integers is the identity
+        return (size_t)(((uint64_t)hash * 0x9E3779B97F4A7C15ull) >> 32) % mStripes.size();
+    }
+
+    template<typename Manip>
+    void readOnly(const size_t &hash, Manip manip)
+    {
+        mStripes[stripeIndex(hash)].readOnly(manip);
+    }
+
+    template<typename Manip>
+    void readWrite(const size_t &hash, Manip manip)
+    {
+        mStripes[stripeIndex(hash)].readWrite(manip);
+    }
+
+    // locks stripes one at a time. it is not a consistent snapshot of all stripes
+    template<typename Manip>
+    void readOnlyEach(Manip manip)
+    {
+        for(auto & stripe : mStripes)
+            stripe.readOnly(manip);
+    }
+
+    template<typename Manip>
+    void readWriteEach(Manip manip)
+    {
+        for(auto & stripe : mStripes)
+            stripe.readWrite(manip);
+    }
+
+private:
+    std::vector<SafeSharedPtr<T>> mStripes;
+};
+
+/**
+ * @brief Concurrent hash map striped by key hash. Writers on keys in different stripes do not block each other.
+ */
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class SafeHashMap
+{
+public:
+    using Map = std::unordered_map<Key, Value, Hash>;
+    using ReadOnlyPtr = typename StripedSafeSharedPtr<Map>::ReadOnlyPtr;
+    using ReadWritePtr = typename StripedSafeSharedPtr<Map>::ReadWritePtr;
+
+    explicit SafeHashMap(const size_t &nStripes = 16) : mStripes(nStripes){}
+
+    // manip gets the stripe containing the key
+    template<typename Manip>
+    void readOnly(const Key &key, Manip manip)
+    {
+        mStripes.readOnly(mHash(key), manip);
+    }
+
+    template<typename Manip>
+    void readWrite(const Key &key, Manip manip)
+    {
+        mStripes.readWrite(mHash(key), manip);
+    }
+
+    void insertOrAssign(const Key &key, const Value &value)
+    {
+        mStripes.readWrite(mHash(key), [&](ReadWritePtr mapPtr){ (*mapPtr)[key] = value; });
+    }
+
+    std::optional<Value> find(const Key &key)
+    {
+        std::optional<Value> value;
+        mStripes.readOnly(mHash(key), [&](ReadOnlyPtr mapPtr)
+        {
+            auto iter = mapPtr->find(key);
+            if(iter != mapPtr->end())
+                value = iter->second;
+        });
+        return value;
+    }
+
+    bool erase(const Key &key)
+    {
+        bool isErased = false;
+        mStripes.readWrite(mHash(key), [&](ReadWritePtr mapPtr){ isErased = mapPtr->erase(key) != 0; });
+        return isErased;
+    }
+
+    size_t size()
+    {
+        size_t nElements = 0;
+        mStripes.readOnlyEach([&](ReadOnlyPtr mapPtr){ nElements += mapPtr->size(); });
+        return nElements;
+    }
+
+    // manip has to be the type: void(const Key&, const Value&)
+    template<typename Manip>
+    void forEach(Manip manip)
+    {
+        mStripes.readOnlyEach([&](ReadOnlyPtr mapPtr)
+        {
+            for(const auto & pair : *mapPtr)
+                manip(pair.first, pair.second);
+        });
+    }
+
+private:
+    StripedSafeSharedPtr<Map> mStripes;
+    Hash mHash;
+};
+
+/**
+ * @brief Concurrent append-only log. Appending threads write to stripes selected by their thread id
+ * and the entries are ordered by a global sequence number on read.
+ */
+template<typename T>
+class SafeAppendLog
+{
+public:
+    explicit SafeAppendLog(const size_t &nStripes = 16) : mStripes(nStripes), mSequenceCount(0){}
+
+    /**
+     * @brief Append an entry.
+     *
+     * @return sequence number of the entry.
+     */
+    uint64_t append(T entry)
+    {
+        uint64_t sequence = mSequenceCount.fetch_add(1, std::memory_order_relaxed);
+        mStripes.readWrite(std::hash<std::thread::id>()(std::this_thread::get_id()), [&](ReadWritePtr logPtr)
+        {
+            logPtr->emplace_back(sequence, std::move(entry));
+        });
+        return sequence;
+    }
+
+    size_t size() const {return mSequenceCount.load(std::memory_order_relaxed);}
+
+    /**
+     * @brief Copy entries ordered by sequence number.
+     */
+    std::vector<T> entries()
+    {
+        std::vector<std::pair<uint64_t, T>> merged;
+        mStripes.readOnlyEach([&](ReadOnlyPtr logPtr){ merged.insert(merged.end(), logPtr->begin(), logPtr->end()); });
+        std::sort(merged.begin(), merged.end(), [](const auto& lhs, const auto& rhs){ return lhs.first < rhs.first; });
+        std::vector<T> sorted;
+        sorted.reserve(merged.size());
+        for(auto & pair : merged)
+            sorted.push_back(std::move(pair.second));
+        return sorted;
+    }
+
+private:
+    using Log = std::vector<std::pair<uint64_t, T>>;
+    using ReadOnlyPtr = typename StripedSafeSharedPtr<Log>::ReadOnlyPtr;
+    using ReadWritePtr = typename StripedSafeSharedPtr<Log>::ReadWritePtr;
+    StripedSafeSharedPtr<Log> mStripes;
+    std::atomic<uint64_t> mSequenceCount;
+};
+
+template<typename T>
+std::atomic<uint64_t> ethr::RcuSharedPtr<T>::versionCount(0);
+
+template<typename T>
+thread_local typename ethr::RcuSharedPtr<T>::ReadCaches ethr::RcuSharedPtr<T>::readCaches;
+
+template<typename T>
+thread_local const typename ethr::RcuSharedPtr<T>::State *ethr::RcuSharedPtr<T>::lastReadStatePtr = nullptr;
+
+template<typename T>
+thread_local typename ethr::RcuSharedPtr<T>::ReadCache *ethr::RcuSharedPtr<T>::lastReadCachePtr = nullptr;
+
 template<typename T>
 ethr::SafeSharedPtr<T>::SafeSharedPtr()
 {
@@ -62,6 +409,27 @@ ethr::SafeSharedPtr<T>::SafeSharedPtr(const SafeSharedPtr &safeSharedPtr)
     mMutexPtr = safeSharedPtr.mMutexPtr;
 }
 
+template<typename T>
+ethr::RcuSharedPtr<T>::RcuSharedPtr()
+{
+    mStatePtr = std::make_shared<State>();
+    mStatePtr->version = versionCount.fetch_add(1) + 1;
+}
+
+template<typename T>
+ethr::RcuSharedPtr<T>::RcuSharedPtr(std::shared_ptr<T> var)
+{
+    mStatePtr = std::make_shared<State>();
+    mStatePtr->snapshot = var;
+    mStatePtr->version = versionCount.fetch_add(1) + 1;
+}
+
+template<typename T>
+ethr::RcuSharedPtr<T>::RcuSharedPtr(const RcuSharedPtr &rcuSharedPtr)
+{
+    mStatePtr = rcuSharedPtr.mStatePtr;
+}
+
 }
 
 #endif
@@ -0,0 +1,933 @@
+#include <ethread.h>
+#include <etimer.h>
+#include <epromise.h>
+#include <eutil.h>
+#include <emessage.h>
+#include <ebalancer.h>
+#include <algorithm>
+#ifndef _WIN32
+#include <efileio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <eshm.h>
+#include <linux/perf_event.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#endif
+#include <cstring>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+using namespace ethr;
+
+// Benchmarks of event_thread. Usage:
+//   benchmark_event_thread [--benchmark_filter=<substring>] [--benchmark_format=console|json] [--benchmark_out=<file>]
+// The JSON output follows the layout of Google Benchmark so the same tools can compare runs.
+
+struct BenchmarkResult
+{
+    std::string name;
+    uint64_t iterations;
+    double realTimeNs;  // per iteration
+    std::vector<std::pair<std::string, double>> counters;
+};
+
+using Clock = std::chrono::high_resolution_clock;
+
+double elapsedNs(const Clock::time_point &startTime)
+{
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - startTime).count();
+}
+
+void waitUntil(const std::function<bool()> &condition)
+{
+    while(!condition())
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+double percentile(std::vector<double> samples, const double &percent)
+{
+    if(samples.empty())
+        return 0;
+    std::sort(samples.begin(), samples.end());
+    auto index = (size_t)(percent / 100.0 * (double)(samples.size() - 1) + 0.5);
+    return samples[index];
+}
+
+// hardware cache misses in user space of this thread and the threads started after it, if perf_event_open() is permitted
+class CacheMissCounter
+{
+public:
+    CacheMissCounter()
+    {
+        mFd = -1;
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        mFd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    ~CacheMissCounter()
+    {
+#ifdef __linux__
+        if(mFd >= 0)
+            close(mFd);
+#endif
+    }
+
+    // the counts of the started threads are added as they exit. -1 if not available
+    long long count() const
+    {
+        long long count = -1;
+#ifdef __linux__
+        if(mFd < 0 || read(mFd, &count, sizeof(count)) != sizeof(count))
+            return -1;
+#endif
+        return count;
+    }
+
+private:
+    int mFd;
+};
+
+class Counter : public EObject
+{
+public:
+    Counter() : mCount(0){}
+    void count(int n)
+    {
+        mCount.fetch_add(n, std::memory_order_relaxed);
+    }
+    std::atomic<long long> mCount;
+};
+
+// events posted from nProducers threads to a single EThread
+void benchmarkPostThroughput(std::vector<BenchmarkResult> &results)
+{
+    const int nEvents = 1 << 17;
+    for(int nProducers : {1, 2, 4, 8})
+    {
+        EThread consumerThread("consumer");
+        consumerThread.setLoopPeriod(std::chrono::milliseconds(0));
+        consumerThread.setEventQueueSize(nEvents);
+        consumerThread.setMetricsEnabled(false);
+        Counter counter;
+        counter.moveToThread(consumerThread);
+        CacheMissCounter cacheMissCounter;
+        consumerThread.start();
+        auto counterRef = counter.ref<Counter>();
+
+        auto startTime = Clock::now();
+        std::vector<std::thread> producers;
+        for(int i=0; i<nProducers; i++)
+        {
+            producers.emplace_back([&]
+            {
+                for(int j=0; j<nEvents / nProducers; j++)
+                    counterRef.callQueued(&Counter::count, 1);
+            });
+        }
+        for(auto & producer : producers)
+            producer.join();
+        waitUntil([&]{ return counter.mCount >= nEvents / nProducers * nProducers; });
+        double totalNs = elapsedNs(startTime);
+
+        consumerThread.stop();
+        counter.removeFromThread();
+        BenchmarkResult result{"post_throughput/producers:" + std::to_string(nProducers), (uint64_t)nEvents,
+                               totalNs / nEvents, {{"items_per_second", nEvents / (totalNs * 1e-9)}}};
+        long long nCacheMisses = cacheMissCounter.count();
+        if(nCacheMisses >= 0)
+            result.counters.emplace_back("cache_misses_per_event", (double)nCacheMisses / nEvents);
+        results.push_back(result);
+    }
+}
+
+class Ponger;
+
+class Pinger : public EObject
+{
+public:
+    void ping(int nRemaining);
+    EObjectRef<Ponger> mPongerRef;
+    std::atomic<bool> mIsDone{false};
+};
+
+class Ponger : public EObject
+{
+public:
+    void pong(int nRemaining)
+    {
+        mPingerRef.callQueued(&Pinger::ping, nRemaining);
+    }
+    EObjectRef<Pinger> mPingerRef;
+};
+
+void Pinger::ping(int nRemaining)
+{
+    if(nRemaining == 0)
+    {
+        mIsDone = true;
+        return;
+    }
+    mPongerRef.callQueued(&Ponger::pong, nRemaining - 1);
+}
+
+// round trips between two EThreads
+void benchmarkPingPong(std::vector<BenchmarkResult> &results)
+{
+    const int nRoundTrips = 10000;
+    EThread pingThread("ping"), pongThread("pong");
+    pingThread.setLoopPeriod(std::chrono::milliseconds(0));
+    pongThread.setLoopPeriod(std::chrono::milliseconds(0));
+    Pinger pinger;
+    Ponger ponger;
+    pinger.moveToThread(pingThread);
+    ponger.moveToThread(pongThread);
+    pinger.mPongerRef = ponger.ref<Ponger>();
+    ponger.mPingerRef = pinger.ref<Pinger>();
+    pingThread.start();
+    pongThread.start();
+
+    auto startTime = Clock::now();
+    pinger.callQueued(&Pinger::ping, nRoundTrips);
+    waitUntil([&]{ return pinger.mIsDone.load(); });
+    double totalNs = elapsedNs(startTime);
+
+    pingThread.stop();
+    pongThread.stop();
+    pinger.removeFromThread();
+    ponger.removeFromThread();
+    results.push_back({"ping_pong_round_trip", (uint64_t)nRoundTrips, totalNs / nRoundTrips, {}});
+}
+
+class Multiplier : public EObject
+{
+public:
+    int multiply(int n)
+    {
+        return n * 2;
+    }
+};
+
+// promise chains of 4 stages alternating between two EThreads
+void benchmarkPromiseChain(std::vector<BenchmarkResult> &results)
+{
+    const int nChains = 5000;
+    EThread threads[2];
+    Multiplier multipliers[2];
+    for(int i=0; i<2; i++)
+    {
+        threads[i].setLoopPeriod(std::chrono::milliseconds(0));
+        threads[i].setEventQueueSize(nChains * 2);
+        multipliers[i].moveToThread(threads[i]);
+        threads[i].start();
+    }
+    std::atomic<int> nCompleted(0);
+
+    auto startTime = Clock::now();
+    for(int i=0; i<nChains; i++)
+    {
+        auto promise = new EPromise(multipliers[0].ref<Multiplier>(), &Multiplier::multiply);
+        promise
+            ->then(multipliers[1].ref<Multiplier>(), &Multiplier::multiply)
+            ->then(multipliers[0].ref<Multiplier>(), &Multiplier::multiply)
+            ->then<int>(multipliers[1].uref(), [&](int n){ nCompleted++; return n; });
+        promise->execute(1);
+    }
+    waitUntil([&]{ return nCompleted.load() >= nChains; });
+    double totalNs = elapsedNs(startTime);
+
+    for(int i=0; i<2; i++)
+    {
+        threads[i].stop();
+        multipliers[i].removeFromThread();
+    }
+    results.push_back({"promise_chain/stages:4", (uint64_t)nChains, totalNs / nChains,
+                       {{"items_per_second", nChains / (totalNs * 1e-9)}}});
+}
+
+class TimerClient : public EObject
+{
+public:
+    void fired()
+    {
+        mFireTimes.push_back(Clock::now());
+    }
+    std::vector<Clock::time_point> mFireTimes;
+};
+
+// deviation of ETimer firings from their ideal schedule
+void benchmarkTimerJitter(std::vector<BenchmarkResult> &results)
+{
+    for(int freq : {100, 1000, 10000})
+    {
+        auto period = std::chrono::nanoseconds(1000000000 / freq);
+        int nFirings = std::max(20, freq / 2);
+        EThread timerThread("timer");
+        timerThread.setLoopPeriod(std::chrono::milliseconds(0));
+        ETimer timer;
+        TimerClient client;
+        timer.moveToThread(timerThread);
+        client.moveToThread(timerThread);
+        client.mFireTimes.reserve(nFirings);
+        auto startTime = Clock::now();
+        timer.addTask(0, period, client.ref<TimerClient>(), &TimerClient::fired, nFirings);
+        timer.start();
+        timerThread.start();
+        std::this_thread::sleep_for(period * nFirings + std::chrono::milliseconds(50));
+        timerThread.stop();
+        timer.removeFromThread();
+        client.removeFromThread();
+
+        std::vector<double> jittersNs;
+        for(size_t i=0; i<client.mFireTimes.size(); i++)
+        {
+            auto idealTime = startTime + period * (i + 1);
+            jittersNs.push_back(std::abs((double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    client.mFireTimes[i] - idealTime).count()));
+        }
+        double meanNs = 0;
+        for(double jitterNs : jittersNs)
+            meanNs += jitterNs / (double)jittersNs.size();
+        results.push_back({"timer_jitter/hz:" + std::to_string(freq), (uint64_t)jittersNs.size(), meanNs,
+                           {{"p50_ns", percentile(jittersNs, 50)}, {"p99_ns", percentile(jittersNs, 99)},
+                            {"max_ns", percentile(jittersNs, 100)}, {"missed", (double)(nFirings - (int)jittersNs.size())}}});
+    }
+}
+
+// EObjectRef::callQueued() with many active EObjects. the target queue size is zero so only the resolution and queueing path is measured
+void benchmarkRefResolve(std::vector<BenchmarkResult> &results)
+{
+    const int nCalls = 100000;
+    for(int nObjects : {16, 1024, 8192})
+    {
+        EThread holderThread("holder"), targetThread("target");
+        targetThread.setEventQueueSize(0);
+        targetThread.setMetricsEnabled(false);
+        std::vector<Counter> objects(nObjects);
+        for(auto & object : objects)
+            object.moveToThread(holderThread);
+        Counter target;
+        target.moveToThread(targetThread);
+        auto targetRef = target.ref<Counter>();
+
+        auto startTime = Clock::now();
+        for(int i=0; i<nCalls; i++)
+            targetRef.callQueued(&Counter::count, 1);
+        double totalNs = elapsedNs(startTime);
+
+        target.removeFromThread();
+        for(auto & object : objects)
+            object.removeFromThread();
+        results.push_back({"ref_resolve/objects:" + std::to_string(nObjects), (uint64_t)nCalls, totalNs / nCalls, {}});
+    }
+}
+
+// round trips of a call from a plain thread to an event-driven EThread. the call is waited by a future,
+// by the idle condition of the EThread, or by polling the result with sleeps.
+// the future wakes the caller as soon as the handler returns, and the idle condition only after the loop has
+// finished the event. with fewer cores than threads the early wake-up interleaves with that work and costs switches
+void benchmarkCallRoundTrip(std::vector<BenchmarkResult> &results)
+{
+    const int nCalls = 1000;
+    EThread targetThread("target");
+    targetThread.setEventDriven(true);
+    Counter target;
+    target.moveToThread(targetThread);
+    targetThread.start();
+    auto targetRef = target.ref<Counter>();
+
+    auto measure = [&](const std::string &name, const std::function<void()> &call)
+    {
+        std::vector<double> latenciesNs;
+        for(int i=0; i<nCalls; i++)
+        {
+            auto startTime = Clock::now();
+            call();
+            latenciesNs.push_back(elapsedNs(startTime));
+        }
+        double meanNs = std::accumulate(latenciesNs.begin(), latenciesNs.end(), 0.0) / nCalls;
+        results.push_back({"call_round_trip/" + name, (uint64_t)nCalls, meanNs,
+                           {{"p50_ns", percentile(latenciesNs, 50)}, {"p99_ns", percentile(latenciesNs, 99)}}});
+    };
+    measure("blocking", [&]{ targetRef.callBlocking(&Counter::count, 1); });
+    measure("idle_wait", [&]
+    {
+        targetRef.callQueued(&Counter::count, 1);
+        targetThread.waitForEventHandleCompletion();
+    });
+    measure("polling", [&]
+    {
+        long long nCounted = target.mCount.load() + 1;
+        targetRef.callQueued(&Counter::count, 1);
+        waitUntil([&]{ return target.mCount.load() >= nCounted; });
+    });
+
+    targetThread.stop();
+    target.removeFromThread();
+}
+
+#ifndef _WIN32
+// sequential writes of a 64MiB file in 256KiB chunks, completed to an EObject. blocking pwrite() is the baseline
+void benchmarkFileWrite(std::vector<BenchmarkResult> &results)
+{
+    const size_t chunkSize = 256 * 1024;
+    const int nChunks = 256;
+    std::vector<char> buffer(chunkSize, 'x');
+    std::string path = "/tmp/benchmark_event_thread_" + std::to_string(getpid());
+
+    EThread writerThread("writer");
+    Counter counter;
+    counter.moveToThread(writerThread);
+    writerThread.start();
+
+    for(const std::string backendName : {"blocking", "io_uring", "thread_pool"})
+    {
+        int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+        if(fd < 0)
+            throw std::runtime_error("failed to open " + path);
+        counter.mCount = 0;
+        std::unique_ptr<EFileIo> fileIoPtr;
+        if(backendName != "blocking")
+        {
+            fileIoPtr = std::make_unique<EFileIo>(32, 4, backendName == "io_uring");
+            if(backendName == "io_uring" && fileIoPtr->backend() != EFileIo::Backend::IO_URING)
+            {
+                std::cerr<<"io_uring is not available"<<std::endl;
+                close(fd);
+                continue;
+            }
+            fileIoPtr->registerBuffers({{buffer.data(), buffer.size()}});
+        }
+
+        auto startTime = Clock::now();
+        for(int i=0; i<nChunks; i++)
+        {
+            if(!fileIoPtr)
+                counter.mCount += pwrite(fd, buffer.data(), chunkSize, (off_t)(i * chunkSize));
+            else
+                fileIoPtr->write(fd, buffer.data(), chunkSize, (int64_t)(i * chunkSize), counter.uref(),
+                                 [&counter](ssize_t result){ counter.count((int)result); });
+        }
+        waitUntil([&]{ return counter.mCount.load() >= (long long)(chunkSize * nChunks); });
+        double totalNs = elapsedNs(startTime);
+
+        fileIoPtr.reset();
+        close(fd);
+        results.push_back({"file_write/" + backendName, (uint64_t)nChunks, totalNs / nChunks,
+                           {{"bytes_per_second", chunkSize * nChunks / (totalNs * 1e-9)}}});
+    }
+
+    writerThread.stop();
+    counter.removeFromThread();
+    unlink(path.c_str());
+}
+#endif
+
+#ifdef __linux__
+// one-way messages of 16 bytes from another process to an EObject, through a shared memory queue or a Unix domain socket
+void benchmarkIpc(std::vector<BenchmarkResult> &results)
+{
+    struct Message
+    {
+        int64_t index;
+        double value;
+    };
+    const int nMessages = 200000;
+
+    for(const std::string transport : {"shm_queue", "unix_socket"})
+    {
+        std::string name = "/benchmark_event_thread_" + std::to_string(getpid());
+        int goPipe[2], socketFds[2];
+        if(pipe(goPipe) != 0 || socketpair(AF_UNIX, SOCK_STREAM, 0, socketFds) != 0)
+            throw std::runtime_error("failed to create pipes");
+
+        // the producer is forked before any thread starts, and waits for the go signal
+        pid_t pid = fork();
+        if(pid == 0)
+        {
+            char go;
+            if(read(goPipe[0], &go, 1) != 1)
+                _exit(1);
+            if(transport == "shm_queue")
+            {
+                EShmProxy proxy(name);
+                for(int64_t i=0; i<nMessages; i++)
+                {
+                    while(!proxy.post(0, Message{i, 1.0}))
+                        std::this_thread::yield();
+                }
+            }
+            else
+            {
+                for(int64_t i=0; i<nMessages; i++)
+                {
+                    Message message{i, 1.0};
+                    if(write(socketFds[1], &message, sizeof(message)) != sizeof(message))
+                        _exit(1);
+                }
+            }
+            _exit(0);
+        }
+
+        EThread receiverThread("receiver");
+        receiverThread.setEpollEnabled(true);
+        Counter counter;
+        counter.moveToThread(receiverThread);
+        EShmReceiver receiver(name, counter.uref(), 4096, sizeof(Message));
+        std::vector<char> socketBuffer(64 * 1024);
+        size_t nBufferedBytes = 0;
+        if(transport == "shm_queue")
+        {
+            receiver.handle<Message>(0, [&counter](Message &&){ counter.count(1); });
+            receiver.start();
+        }
+        else
+        {
+            receiverThread.watchFd(counter, socketFds[0], EPOLLIN, [&](uint32_t)
+            {
+                auto nRead = read(socketFds[0], socketBuffer.data() + nBufferedBytes, socketBuffer.size() - nBufferedBytes);
+                if(nRead <= 0)
+                    return;
+                nBufferedBytes += nRead;
+                size_t nReceived = nBufferedBytes / sizeof(Message);
+                counter.count((int)nReceived);
+                nBufferedBytes -= nReceived * sizeof(Message);
+                std::memmove(socketBuffer.data(), socketBuffer.data() + nReceived * sizeof(Message), nBufferedBytes);
+            });
+        }
+        receiverThread.start();
+
+        auto startTime = Clock::now();
+        if(write(goPipe[1], "g", 1) != 1)
+            throw std::runtime_error("failed to start the producer");
+        waitUntil([&]{ return counter.mCount.load() >= nMessages; });
+        double totalNs = elapsedNs(startTime);
+
+        waitpid(pid, nullptr, 0);
+        receiverThread.stop();
+        counter.removeFromThread();
+        for(int fd : {goPipe[0], goPipe[1], socketFds[0], socketFds[1]})
+            close(fd);
+        results.push_back({"ipc/" + transport, (uint64_t)nMessages, totalNs / nMessages,
+                           {{"items_per_second", nMessages / (totalNs * 1e-9)}}});
+    }
+}
+#endif
+
+struct Sample
+{
+    int64_t index;
+    double value;
+    int channel;
+};
+
+struct Flush
+{
+};
+
+class SampleSink : public EMessageObject<SampleSink, Sample, Flush>
+{
+public:
+    void onMessage(Sample &)
+    {
+        mCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void onMessage(Flush &)
+    {
+    }
+
+    void sample(int64_t, double, int)
+    {
+        mCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::atomic<long long> mCount{0};
+};
+
+// per-event cost of a 3-argument call posted from another thread, as a bound std::function or as a typed message
+void benchmarkTypedMessage(std::vector<BenchmarkResult> &results)
+{
+    const int nEvents = 1 << 17;
+    for(const std::string mode : {"call_queued", "post"})
+    {
+        EThread consumerThread("consumer");
+        consumerThread.setLoopPeriod(std::chrono::milliseconds(0));
+        consumerThread.setEventQueueSize(nEvents);
+        consumerThread.setMetricsEnabled(false);
+        SampleSink sink;
+        sink.moveToThread(consumerThread);
+        sink.setMessageQueueSize(nEvents);
+        consumerThread.start();
+        auto sinkRef = sink.ref<SampleSink>();
+
+        auto startTime = Clock::now();
+        std::thread producer([&]
+        {
+            for(int64_t i=0; i<nEvents; i++)
+            {
+                if(mode == "call_queued")
+                    sinkRef.callQueued(&SampleSink::sample, i, 1.0, 0);
+                else
+                    sinkRef.post(Sample{i, 1.0, 0});
+            }
+        });
+        producer.join();
+        waitUntil([&]{ return sink.mCount >= nEvents; });
+        double totalNs = elapsedNs(startTime);
+
+        consumerThread.stop();
+        sink.removeFromThread();
+        results.push_back({"typed_message/" + mode, (uint64_t)nEvents, totalNs / nEvents,
+                           {{"items_per_second", nEvents / (totalNs * 1e-9)}}});
+    }
+}
+
+// bring-up and tear-down of 64 EThreads with 16 EObjects each, one by one or as a group
+void benchmarkThreadLifecycle(std::vector<BenchmarkResult> &results)
+{
+    const int nThreads = 64;
+    const int nEObjectsPerThread = 16;
+    for(const std::string mode : {"serial", "group"})
+    {
+        std::vector<std::unique_ptr<EThread>> ethreadPtrs;
+        std::vector<EThread*> ethreads;
+        for(int i=0; i<nThreads; i++)
+        {
+            ethreadPtrs.push_back(std::make_unique<EThread>("worker" + std::to_string(i)));
+            ethreads.push_back(ethreadPtrs.back().get());
+        }
+        std::vector<Counter> counters(nThreads * nEObjectsPerThread);
+
+        auto startTime = Clock::now();
+        for(int i=0; i<nThreads; i++)
+        {
+            if(mode == "serial")
+            {
+                for(int j=0; j<nEObjectsPerThread; j++)
+                    counters[i * nEObjectsPerThread + j].moveToThread(*ethreads[i]);
+                ethreads[i]->start();
+            }
+            else
+            {
+                std::vector<EObject*> eObjects;
+                for(int j=0; j<nEObjectsPerThread; j++)
+                    eObjects.push_back(&counters[i * nEObjectsPerThread + j]);
+                EObject::moveToThread(eObjects, *ethreads[i]);
+            }
+        }
+        if(mode == "group")
+            EThread::startAll(ethreads);
+        double startupNs = elapsedNs(startTime);
+
+        startTime = Clock::now();
+        if(mode == "serial")
+        {
+            for(auto *ethreadPtr : ethreads)
+                ethreadPtr->stop();
+        }
+        else
+        {
+            EThread::stopAll(ethreads);
+        }
+        double shutdownNs = elapsedNs(startTime);
+
+        for(auto &counter : counters)
+            counter.removeFromThread();
+        results.push_back({"thread_lifecycle/" + mode, (uint64_t)nThreads, (startupNs + shutdownNs) / nThreads,
+                           {{"startup_ns", startupNs}, {"shutdown_ns", shutdownNs}}});
+    }
+}
+
+class Spinner : public EObject
+{
+public:
+    void spin(int durationUs)
+    {
+        auto endTime = Clock::now() + std::chrono::microseconds(durationUs);
+        while(Clock::now() < endTime);
+        mCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    void block(int durationUs)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(durationUs));
+        mCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::atomic<long long> mCount{0};
+};
+
+// 8 EObjects of 50us handlers all placed in the first of 4 EThreads, left there or spread by ELoadBalancer.
+// the handlers spin, which gains only with free cores, or block as on I/O, which gains on any machine
+void benchmarkSkewedLoad(std::vector<BenchmarkResult> &results)
+{
+    const int nThreads = 4;
+    const int nSpinners = 8;
+    for(const std::string workload : {"spin", "block"})
+    {
+        const int nEventsPerSpinner = workload == "spin" ? 2000 : 500;
+        auto handler = workload == "spin" ? &Spinner::spin : &Spinner::block;
+        for(const std::string mode : {"static", "balanced"})
+        {
+            std::vector<std::unique_ptr<EThread>> ethreadPtrs;
+            std::vector<EThread*> ethreads;
+            for(int i=0; i<nThreads; i++)
+            {
+                ethreadPtrs.push_back(std::make_unique<EThread>("worker" + std::to_string(i)));
+                ethreadPtrs.back()->setEventQueueSize(nSpinners * nEventsPerSpinner);
+                ethreadPtrs.back()->setEventDriven(true);
+                ethreads.push_back(ethreadPtrs.back().get());
+            }
+            std::vector<Spinner> spinners(nSpinners);
+            std::vector<EObject*> eObjects;
+            for(auto& spinner : spinners)
+                eObjects.push_back(&spinner);
+            std::unique_ptr<ELoadBalancer> balancerPtr;
+            if(mode == "balanced")
+                balancerPtr = std::make_unique<ELoadBalancer>(ethreads);
+            EObject::moveToThread(eObjects, *ethreads[0]);
+            EThread::startAll(ethreads);
+            if(balancerPtr)
+                balancerPtr->start(std::chrono::milliseconds(5));
+
+            auto startTime = Clock::now();
+            for(int i=0; i<nEventsPerSpinner; i++)
+            {
+                for(auto& spinner : spinners)
+                    spinner.ref<Spinner>().callQueued(handler, 50);
+            }
+            EThread::waitForQuiescence(ethreads);
+            double totalNs = elapsedNs(startTime);
+
+            size_t nMigrations = 0;
+            if(balancerPtr)
+            {
+                balancerPtr->stop();
+                nMigrations = balancerPtr->nMigrations();
+            }
+            // share of the events handled by the busiest EThread. 1 / nThreads when spread evenly
+            uint64_t nEvents = (uint64_t)nSpinners * nEventsPerSpinner;
+            uint64_t nBusiestHandled = 0;
+            for(auto* ethreadPtr : ethreads)
+                nBusiestHandled = std::max(nBusiestHandled, ethreadPtr->metrics().nHandledEvents);
+            EThread::stopAll(ethreads);
+            EObject::removeFromThread(eObjects);
+            results.push_back({"skewed_load/" + (workload == "spin" ? mode : workload + "_" + mode), nEvents, totalNs / (double)nEvents,
+                               {{"items_per_second", (double)nEvents / (totalNs * 1e-9)}, {"migrations", (double)nMigrations},
+                                {"busiest_share", (double)nBusiestHandled / (double)nEvents}}});
+        }
+    }
+}
+
+// lateness of 1kHz, 100Hz and 10Hz callbacks sharing one thread, as ETimer tasks or as fixed-rate tasks of the EThread
+void benchmarkMultiRate(std::vector<BenchmarkResult> &results)
+{
+    const std::vector<int> freqs = {1000, 100, 10};
+    const auto duration = std::chrono::milliseconds(500);
+    for(const std::string mode : {"etimer", "fixed_rate"})
+    {
+        EThread rateThread("rates");
+        rateThread.setLoopPeriod(std::chrono::milliseconds(0));
+        ETimer timer;
+        TimerClient client;
+        std::vector<std::vector<Clock::time_point>> fireTimes(freqs.size());
+        for(size_t i=0; i<freqs.size(); i++)
+        {
+            auto period = std::chrono::nanoseconds(1000000000 / freqs[i]);
+            auto& rateFireTimes = fireTimes[i];
+            rateFireTimes.reserve(duration / period + 1);
+            auto fired = [&rateFireTimes]{ rateFireTimes.push_back(Clock::now()); };
+            if(mode == "etimer")
+                timer.addTask((int)i, period, client.ref<TimerClient>(), fired, (int)(duration / period));
+            else
+                rateThread.addFixedRateTask(period, fired, period);
+        }
+        if(mode == "etimer")
+        {
+            timer.moveToThread(rateThread);
+            client.moveToThread(rateThread);
+            timer.start();
+        }
+        auto startTime = Clock::now();
+        rateThread.start();
+        std::this_thread::sleep_for(duration + std::chrono::milliseconds(5));
+        rateThread.stop();
+        if(mode == "etimer")
+        {
+            timer.removeFromThread();
+            client.removeFromThread();
+        }
+
+        // lateness from the last tick of the ideal schedule, so that a skipped run does not shift the later ones
+        std::vector<double> latenessesNs;
+        int nMissed = 0;
+        for(size_t i=0; i<freqs.size(); i++)
+        {
+            auto period = std::chrono::nanoseconds(1000000000 / freqs[i]);
+            for(auto& fireTime : fireTimes[i])
+                latenessesNs.push_back((double)((fireTime - startTime) % period).count());
+            nMissed += (int)(duration / period) - (int)fireTimes[i].size();
+        }
+        double meanNs = 0;
+        for(double latenessNs : latenessesNs)
+            meanNs += latenessNs / (double)latenessesNs.size();
+        results.push_back({"multi_rate/" + mode, (uint64_t)latenessesNs.size(), meanNs,
+                           {{"p50_ns", percentile(latenessesNs, 50)}, {"p99_ns", percentile(latenessesNs, 99)},
+                            {"max_ns", percentile(latenessesNs, 100)}, {"missed", (double)std::max(0, nMissed)}}});
+    }
+}
+
+// reads per second of a shared table from nReaders threads
+template<typename SharedTable>
+void benchmarkSharedRead(std::vector<BenchmarkResult> &results, const std::string &name)
+{
+    for(int nReaders : {1, 2, 4, 8})
+    {
+        SharedTable table(std::make_shared<std::vector<int>>(64, 1));
+        std::atomic<bool> isRunning(true);
+        std::atomic<long long> nReads(0);
+        std::vector<std::thread> readers;
+        auto startTime = Clock::now();
+        for(int i=0; i<nReaders; i++)
+        {
+            readers.emplace_back([&]
+            {
+                long long nReadsHere = 0;
+                long long sum = 0;
+                while(isRunning.load(std::memory_order_relaxed))
+                {
+                    table.readOnly([&](typename SharedTable::ReadOnlyPtr tablePtr){ sum += (*tablePtr)[nReadsHere % 64]; });
+                    nReadsHere++;
+                }
+                nReads += nReadsHere;
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        isRunning = false;
+        for(auto & reader : readers)
+            reader.join();
+        double totalNs = elapsedNs(startTime);
+        results.push_back({name + "/readers:" + std::to_string(nReaders), (uint64_t)nReads,
+                           totalNs * nReaders / (double)nReads, {{"items_per_second", (double)nReads / (totalNs * 1e-9)}}});
+    }
+}
+
+void writeConsoleHeader(std::ostream &ostream)
+{
+    ostream<<std::left<<std::setw(40)<<"Benchmark"<<std::right<<std::setw(16)<<"Time"<<std::setw(14)<<"Iterations"<<"  Counters"<<std::endl;
+    ostream<<std::string(90, '-')<<std::endl;
+}
+
+void writeConsole(std::ostream &ostream, const std::vector<BenchmarkResult> &results)
+{
+    for(const auto& result : results)
+    {
+        std::ostringstream time;
+        time<<std::fixed<<std::setprecision(1)<<result.realTimeNs<<" ns";
+        ostream<<std::left<<std::setw(40)<<result.name<<std::right<<std::setw(16)<<time.str()<<std::setw(14)<<result.iterations<<" ";
+        for(const auto& counter : result.counters)
+            ostream<<" "<<counter.first<<"="<<counter.second;
+        ostream<<std::endl;
+    }
+}
+
+void writeJson(std::ostream &ostream, const std::vector<BenchmarkResult> &results)
+{
+    ostream<<"{\n  \"context\": {\n"
+        <<"    \"library\": \"event_thread\",\n"
+        <<"    \"num_cpus\": "<<std::thread::hardware_concurrency()<<"\n"
+        <<"  },\n  \"benchmarks\": [";
+    for(size_t i=0; i<results.size(); i++)
+    {
+        const auto& result = results[i];
+        ostream<<(i == 0 ? "\n" : ",\n")
+            <<"    {\n"
+            <<"      \"name\": \""<<result.name<<"\",\n"
+            <<"      \"run_type\": \"iteration\",\n"
+            <<"      \"iterations\": "<<result.iterations<<",\n"
+            <<"      \"real_time\": "<<result.realTimeNs<<",\n"
+            <<"      \"time_unit\": \"ns\"";
+        for(const auto& counter : result.counters)
+            ostream<<",\n      \""<<counter.first<<"\": "<<counter.second;
+        ostream<<"\n    }";
+    }
+    ostream<<"\n  ]\n}"<<std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    std::string filter, format = "console", outPath;
+    for(int i=1; i<argc; i++)
+    {
+        std::string arg = argv[i];
+        auto value = arg.substr(arg.find('=') + 1);
+        if(arg.rfind("--benchmark_filter=", 0) == 0)
+            filter = value;
+        else if(arg.rfind("--benchmark_format=", 0) == 0)
+            format = value;
+        else if(arg.rfind("--benchmark_out=", 0) == 0)
+            outPath = value;
+        else
+        {
+            std::cerr<<"unknown argument: "<<arg<<std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::pair<std::string, std::function<void(std::vector<BenchmarkResult>&)>>> benchmarks = {
+            {"post_throughput", benchmarkPostThroughput},
+            {"ping_pong_round_trip", benchmarkPingPong},
+            {"promise_chain", benchmarkPromiseChain},
+            {"timer_jitter", benchmarkTimerJitter},
+            {"ref_resolve", benchmarkRefResolve},
+            {"call_round_trip", benchmarkCallRoundTrip},
+#ifndef _WIN32
+            {"file_write", benchmarkFileWrite},
+#endif
+#ifdef __linux__
+            {"ipc", benchmarkIpc},
+#endif
+            {"typed_message", benchmarkTypedMessage},
+            {"thread_lifecycle", benchmarkThreadLifecycle},
+            {"skewed_load", benchmarkSkewedLoad},
+            {"multi_rate", benchmarkMultiRate},
+            {"safe_shared_ptr_read", [](auto &results){ benchmarkSharedRead<SafeSharedPtr<std::vector<int>>>(results, "safe_shared_ptr_read"); }},
+            {"rcu_shared_ptr_read", [](auto &results){ benchmarkSharedRead<RcuSharedPtr<std::vector<int>>>(results, "rcu_shared_ptr_read"); }},
+    };
+
+    std::vector<BenchmarkResult> results;
+    if(format == "console")
+        writeConsoleHeader(std::cout);
+    for(const auto& benchmark : benchmarks)
+    {
+        if(benchmark.first.find(filter) == std::string::npos)
+            continue;
+        std::vector<BenchmarkResult> benchmarkResults;
+        benchmark.second(benchmarkResults);
+        if(format == "console")
+            writeConsole(std::cout, benchmarkResults);
+        results.insert(results.end(), benchmarkResults.begin(), benchmarkResults.end());
+    }
+
+    if(format == "json")
+        writeJson(std::cout, results);
+    if(!outPath.empty())
+    {
+        std::ofstream outFile(outPath);
+        writeJson(outFile, results);
+    }
+}
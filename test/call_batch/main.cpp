@@ -0,0 +1,63 @@
+#include <ethread.h>
+#include <atomic>
+
+using namespace ethr;
+
+class Worker : public EObject
+{
+public:
+    Worker() : mNCalled(0){}
+    void count(int n)
+    {
+        mNCalled.fetch_add(n, std::memory_order_relaxed);
+    }
+    std::atomic<long long> mNCalled;
+};
+
+// posts nCalls in rounds of batchSize calls and waits until all of them are handled
+template<typename PostRound>
+double measureNsPerCall(Worker &worker, const int &batchSize, const int &nCalls, PostRound postRound)
+{
+    worker.mNCalled = 0;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for(int nPosted = 0; nPosted < nCalls; nPosted += batchSize)
+        postRound();
+    while(worker.mNCalled.load(std::memory_order_relaxed) < nCalls)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    auto elapsed = std::chrono::high_resolution_clock::now() - startTime;
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / nCalls;
+}
+
+int main()
+{
+    const int nCalls = 1 << 18;
+    EThread workerThread("worker");
+    workerThread.setLoopPeriod(std::chrono::milliseconds(0));
+    workerThread.setEventQueueSize(nCalls);
+    Worker worker;
+    worker.moveToThread(workerThread);
+    workerThread.start();
+    auto workerRef = worker.ref<Worker>();
+
+    std::cout<<"batch size, per-call posting [ns/call], batched posting [ns/call]"<<std::endl;
+    for(int batchSize = 1; batchSize <= 1024; batchSize *= 2)
+    {
+        double perCallNs = measureNsPerCall(worker, batchSize, nCalls, [&]
+        {
+            for(int i=0; i<batchSize; i++)
+                workerRef.callQueued(&Worker::count, 1);
+        });
+        auto batch = workerRef.batch();
+        double batchedNs = measureNsPerCall(worker, batchSize, nCalls, [&]
+        {
+            batch.reserve(batchSize);
+            for(int i=0; i<batchSize; i++)
+                batch.callQueued(&Worker::count, 1);
+            batch.post();
+        });
+        std::cout<<batchSize<<", "<<perCallNs<<", "<<batchedNs<<std::endl;
+    }
+
+    workerThread.stop();
+    worker.removeFromThread();
+}
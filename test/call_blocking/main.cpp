@@ -0,0 +1,93 @@
+#include <ethread.h>
+
+using namespace ethr;
+
+class Calculator : public EObject
+{
+public:
+    int add(int a, int b)
+    {
+        return a + b;
+    }
+
+    void fail()
+    {
+        throw std::runtime_error("failed in the handler");
+    }
+
+    void sleep(int milliseconds)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+    }
+
+    int addTwice(EObjectRef<Calculator> self, int a)
+    {
+        // blocking call to an EObject in the same EThread runs inline instead of deadlocking
+        return self.callBlocking(&Calculator::add, a, a);
+    }
+};
+
+int main()
+{
+    EThread workerThread("worker");
+    workerThread.setEventDriven(true);
+    Calculator calculator;
+    calculator.moveToThread(workerThread);
+    workerThread.start();
+    auto calculatorRef = calculator.ref<Calculator>();
+
+    std::cout<<"1 + 2 = "<<calculatorRef.callBlocking(&Calculator::add, 1, 2)<<std::endl;
+    std::cout<<"3 + 3 = "<<calculatorRef.callBlocking(&Calculator::addTwice, calculatorRef, 3)<<std::endl;
+
+    auto future = calculatorRef.callAsync(&Calculator::sleep, 50);
+    std::cout<<"ready right after callAsync(): "<<future.isReady()<<std::endl;
+    future.get();
+    std::cout<<"sleep done"<<std::endl;
+
+    try
+    {
+        calculatorRef.callBlocking(&Calculator::fail);
+    }
+    catch(const std::runtime_error &e)
+    {
+        std::cout<<"exception from the handler: "<<e.what()<<std::endl;
+    }
+
+    // a call to a stopped EThread waits for the next start()
+    workerThread.stop();
+    auto pendingFuture = calculatorRef.callAsync(&Calculator::add, 5, 6);
+    if(pendingFuture.waitFor(std::chrono::milliseconds(20)))
+        throw std::runtime_error("call to a stopped EThread is handled");
+    workerThread.start();
+    if(!pendingFuture.waitFor(std::chrono::seconds(1)) || pendingFuture.get() != 11)
+        throw std::runtime_error("queued call is not handled after restart");
+    std::cout<<"5 + 6 = 11 after restart"<<std::endl;
+
+    workerThread.stop();
+    calculator.removeFromThread();
+
+    try
+    {
+        calculatorRef.callBlocking(&Calculator::add, 1, 2);
+    }
+    catch(const std::runtime_error &e)
+    {
+        std::cout<<"exception from a removed EObject: "<<e.what()<<std::endl;
+    }
+
+    // removing an EObject breaks the promises of its calls queued to a stopped EThread
+    calculator.moveToThread(workerThread);
+    auto droppedFuture = calculator.ref<Calculator>().callAsync(&Calculator::add, 7, 8);
+    calculator.removeFromThread();
+    if(!droppedFuture.waitFor(std::chrono::seconds(1)))
+        throw std::runtime_error("promise of a removed EObject is not broken");
+    try
+    {
+        droppedFuture.get();
+        throw std::logic_error("call to a removed EObject is handled");
+    }
+    catch(const std::runtime_error &e)
+    {
+        std::cout<<"exception from a dropped call: "<<e.what()<<std::endl;
+    }
+}
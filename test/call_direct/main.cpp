@@ -0,0 +1,91 @@
+#include <ethread.h>
+
+using namespace ethr;
+
+class Stage : public EObject
+{
+public:
+    void setNext(EObjectRef<Stage> next, bool isDirect)
+    {
+        mNext = next;
+        mIsDirect = isDirect;
+    }
+
+    void process(std::chrono::high_resolution_clock::time_point startTime, int nHops)
+    {
+        if(nHops == 0)
+        {
+            latency = std::chrono::high_resolution_clock::now() - startTime;
+            isDone = true;
+            return;
+        }
+        if(mIsDirect)
+            mNext.callDirectOrQueued(&Stage::process, startTime, nHops - 1);
+        else
+            mNext.callQueued(&Stage::process, startTime, nHops - 1);
+    }
+
+    void recurse(int n)
+    {
+        maxDepth = std::max(maxDepth, ++depth);
+        if(n > 0)
+            callDirectOrQueued(&Stage::recurse, n - 1);
+        depth--;
+        nRecursions++;
+    }
+
+    EObjectRef<Stage> mNext;
+    bool mIsDirect = false;
+    std::atomic<bool> isDone{false};
+    std::chrono::high_resolution_clock::duration latency{0};
+    int depth = 0;
+    int maxDepth = 0;
+    std::atomic<int> nRecursions{0};
+};
+
+void runPipeline(EThread &ethread, bool isDirect)
+{
+    Stage stages[4];
+    for(auto& stage : stages)
+        stage.moveToThread(ethread);
+    for(int i=0; i<4; i++)
+        stages[i].setNext(stages[(i + 1) % 4].ref<Stage>(), isDirect);
+
+    stages[0].callQueued(&Stage::process, std::chrono::high_resolution_clock::now(), 100);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    std::cout<<(isDirect ? "callDirectOrQueued" : "callQueued")<<": 100 hops on the same EThread took "
+        <<(stages[0].isDone ? std::chrono::duration_cast<std::chrono::microseconds>(stages[0].latency).count() : -1)<<"us"<<std::endl;
+
+    for(auto& stage : stages)
+        stage.removeFromThread();
+}
+
+int main()
+{
+    EThread workerThread("worker");
+    workerThread.setDirectCallDepthLimit(8);
+    workerThread.start();
+
+    runPipeline(workerThread, false);
+    runPipeline(workerThread, true);
+
+    // nested direct calls over the depth limit are queued
+    Stage stage;
+    stage.moveToThread(workerThread);
+    stage.callQueued(&Stage::recurse, 100);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    std::cout<<"recursions: "<<stage.nRecursions<<", max depth: "<<stage.maxDepth<<std::endl;
+
+    // a call from outside of the EThread is queued
+    if(EThread::currentThread() != nullptr)
+        throw std::runtime_error("main thread is not an EThread");
+    stage.callDirectOrQueued(&Stage::recurse, 0);
+    workerThread.waitForEventHandleCompletion();
+    std::cout<<"recursions after a call from outside: "<<stage.nRecursions<<std::endl;
+
+    workerThread.stop();
+    stage.removeFromThread();
+
+    if(stage.nRecursions != 102 || stage.maxDepth != 9)
+        throw std::runtime_error("unexpected direct call depth");
+}
@@ -0,0 +1,68 @@
+#include <ethread.h>
+#include <etimer.h>
+
+using namespace ethr;
+
+class App : public EObject
+{
+public:
+    class Sensor : public EObject
+    {
+    public:
+        EObjectRef<App> mAppRef;
+        void sample(int nSamples)
+        {
+            for(int i=1; i<=nSamples; i++)
+                mAppRef.callQueuedCoalesced(&App::sampleReceived, i);
+            mAppRef.callQueued(&App::samplingFinished, nSamples);
+        }
+    };
+
+    App()
+    {
+        mNReceived = 0;
+        mLatestSample = 0;
+        mSensor.mAppRef = this->ref<App>();
+        mSensor.moveToThread(mSensorThread);
+        mSensorThread.start();
+
+        mTimer.moveToThread(EThread::mainThread());
+        mTimer.addTask(0, std::chrono::milliseconds(0), this->uref(), [&]
+        {
+            mSensor.callQueued(&Sensor::sample, 10000);
+        }, 1);
+        mTimer.start();
+    }
+    ~App()
+    {
+        mSensorThread.stop();
+        mSensor.removeFromThread();
+        mTimer.removeFromThread();
+    }
+    void sampleReceived(int sample)
+    {
+        mNReceived++;
+        mLatestSample = sample;
+    }
+    void samplingFinished(int nSamples)
+    {
+        std::cout<<"posted: "<<nSamples<<" received: "<<mNReceived<<" latest: "<<mLatestSample<<std::endl;
+        EThread::stopMainThread();
+    }
+private:
+    ETimer mTimer;
+    Sensor mSensor;
+    EThread mSensorThread;
+    int mNReceived;
+    int mLatestSample;
+};
+
+int main()
+{
+    EThread mainThread("main");
+    EThread::provideMainThread(mainThread);
+    App app;
+    app.moveToThread(mainThread);
+    mainThread.start();
+    app.removeFromThread();
+}
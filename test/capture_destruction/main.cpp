@@ -0,0 +1,90 @@
+#include <ethread.h>
+
+using namespace ethr;
+
+class Counter : public EObject
+{
+public:
+    void count()
+    {
+        nCalls++;
+    }
+
+    void hold(std::shared_ptr<struct PostOnDestruction>)
+    {
+    }
+
+    std::atomic<int> nCalls{0};
+};
+
+// posts to the EObject when the last copy of a queued call holding it is destroyed
+struct PostOnDestruction
+{
+    explicit PostOnDestruction(EObjectRef<Counter> ref) : ref(ref){}
+
+    ~PostOnDestruction()
+    {
+        ref.callQueued(&Counter::count);
+    }
+
+    EObjectRef<Counter> ref;
+};
+
+// a call replaced by a coalesced post is destroyed outside the event queue lock
+void checkReplacedCoalescedCall()
+{
+    EThread ethread("coalesced");
+    Counter counter;
+    counter.moveToThread(ethread);
+    counter.callQueuedCoalesced(&Counter::hold, std::make_shared<PostOnDestruction>(counter.ref<Counter>()));
+    counter.callQueuedCoalesced(&Counter::hold, std::shared_ptr<PostOnDestruction>());
+    ethread.start();
+    ethread.waitForEventHandleCompletion();
+    ethread.stop();
+    counter.removeFromThread();
+    std::cout<<"calls posted by a replaced coalesced call: "<<counter.nCalls<<std::endl;
+    if(counter.nCalls != 1)
+        throw std::runtime_error("call posted by a replaced coalesced call is lost");
+}
+
+// a handled call is destroyed outside the event queue lock
+void checkHandledCall()
+{
+    EThread ethread("handled");
+    Counter counter;
+    counter.moveToThread(ethread);
+    ethread.start();
+    counter.callQueued(&Counter::hold, std::make_shared<PostOnDestruction>(counter.ref<Counter>()));
+    ethread.waitForEventHandleCompletion();
+    ethread.stop();
+    counter.removeFromThread();
+    std::cout<<"calls posted by a handled call: "<<counter.nCalls<<std::endl;
+    if(counter.nCalls != 1)
+        throw std::runtime_error("call posted by a handled call is lost");
+}
+
+// calls queued to a removed EObject are destroyed outside the event queue lock
+void checkRemovedCall()
+{
+    EThread ethread("removed");
+    Counter removed;
+    Counter counter;
+    removed.moveToThread(ethread);
+    counter.moveToThread(ethread);
+    removed.callQueued(&Counter::hold, std::make_shared<PostOnDestruction>(counter.ref<Counter>()));
+    removed.removeFromThread();
+    ethread.start();
+    ethread.waitForEventHandleCompletion();
+    ethread.stop();
+    counter.removeFromThread();
+    std::cout<<"calls posted by a call to a removed EObject: "<<counter.nCalls<<std::endl;
+    if(counter.nCalls != 1 || removed.nCalls != 0)
+        throw std::runtime_error("call posted by a call to a removed EObject is lost");
+}
+
+int main()
+{
+    checkReplacedCoalescedCall();
+    checkHandledCall();
+    checkRemovedCall();
+}
@@ -0,0 +1,80 @@
+#include <ethread.h>
+#include <echannel.h>
+#include <atomic>
+
+using namespace ethr;
+
+std::atomic<long long> nDelivered(0);
+
+class Subscriber : public EObject
+{
+public:
+    void messageReceived(const std::vector<int> &)
+    {
+        nDelivered.fetch_add(1, std::memory_order_relaxed);
+    }
+    void messageCopyReceived(std::vector<int>)
+    {
+        nDelivered.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+template<typename Publish>
+double measureMessagesPerSec(const long long &nDeliveries, const int &nMessages, Publish publish)
+{
+    nDelivered = 0;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for(int i=0; i<nMessages; i++)
+        publish();
+    while(nDelivered.load(std::memory_order_relaxed) < nDeliveries)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+    return nMessages / elapsed.count();
+}
+
+int main()
+{
+    const int nThreads = 4;
+    const int nMessages = 2000;
+    const std::vector<int> message(256, 1);
+
+    EThread threads[nThreads];
+    for(auto & thread : threads)
+    {
+        thread.setLoopPeriod(std::chrono::milliseconds(0));
+        thread.setEventQueueSize(1 << 20);
+        thread.start();
+    }
+
+    std::cout<<"subscribers, EChannel::publish() [msg/s], callQueued() per subscriber [msg/s]"<<std::endl;
+    for(int nSubscribers : {1, 16, 256})
+    {
+        std::vector<Subscriber> subscribers(nSubscribers);
+        EChannel<std::vector<int>> channel;
+        std::vector<EObjectRef<Subscriber>> subscriberRefs;
+        for(int i=0; i<nSubscribers; i++)
+        {
+            subscribers[i].moveToThread(threads[i % nThreads]);
+            channel.subscribe(subscribers[i].ref<Subscriber>(), &Subscriber::messageReceived);
+            subscriberRefs.push_back(subscribers[i].ref<Subscriber>());
+        }
+
+        long long nDeliveries = (long long)nSubscribers * nMessages;
+        double channelRate = measureMessagesPerSec(nDeliveries, nMessages, [&]
+        {
+            channel.publish(message);
+        });
+        double loopRate = measureMessagesPerSec(nDeliveries, nMessages, [&]
+        {
+            for(auto & subscriberRef : subscriberRefs)
+                subscriberRef.callQueued(&Subscriber::messageCopyReceived, message);
+        });
+        std::cout<<nSubscribers<<", "<<channelRate<<", "<<loopRate<<std::endl;
+
+        for(auto & subscriber : subscribers)
+            subscriber.removeFromThread();
+    }
+
+    for(auto & thread : threads)
+        thread.stop();
+}
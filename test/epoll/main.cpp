@@ -0,0 +1,118 @@
+#include <ethread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace ethr;
+
+class PipeReader : public EObject
+{
+public:
+    void onReadable(int fd, uint32_t events)
+    {
+        char buffer[256];
+        auto nRead = read(fd, buffer, sizeof(buffer));
+        if(nRead > 0)
+            received.append(buffer, nRead);
+        nReceived = received.size();
+    }
+
+    void ping(std::chrono::high_resolution_clock::time_point queuedTime)
+    {
+        latency = std::chrono::high_resolution_clock::now() - queuedTime;
+    }
+
+    std::string received;
+    std::atomic<size_t> nReceived{0};
+    std::chrono::high_resolution_clock::duration latency{0};
+};
+
+class EchoServer : public EObject
+{
+public:
+    void onReadable(int fd, uint32_t events)
+    {
+        char buffer[256];
+        auto nRead = read(fd, buffer, sizeof(buffer));
+        if(nRead > 0)
+            write(fd, buffer, nRead);
+    }
+};
+
+class Ticker : public EThread
+{
+public:
+    std::atomic<int> nTasks{0};
+protected:
+    void task() override
+    {
+        nTasks++;
+    }
+};
+
+int main()
+{
+    // pipe read by an EObject in an EThread with a slow loop
+    Ticker readerThread;
+    readerThread.setLoopPeriod(std::chrono::milliseconds(100));
+    readerThread.setEpollEnabled(true);
+    PipeReader reader;
+    reader.moveToThread(readerThread);
+    int pipeFds[2];
+    if(pipe(pipeFds) != 0)
+        throw std::runtime_error("pipe() failed");
+    readerThread.watchFd(reader, pipeFds[0], EPOLLIN, [&reader, fd = pipeFds[0]](uint32_t events){ reader.onReadable(fd, events); });
+    readerThread.start();
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    write(pipeFds[1], "hello ", 6);
+    while(reader.nReceived < 6 && std::chrono::high_resolution_clock::now() - startTime < std::chrono::seconds(1))
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    std::cout<<"pipe read after "<<std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - startTime).count()<<"us: "<<reader.received<<std::endl;
+    write(pipeFds[1], "world", 5);
+
+    // queued events wake the loop up through the eventfd
+    reader.callQueued(&PipeReader::ping, std::chrono::high_resolution_clock::now());
+    std::this_thread::sleep_for(std::chrono::milliseconds(350));
+    std::cout<<"event latency with the loop period of 100ms: "
+        <<std::chrono::duration_cast<std::chrono::microseconds>(reader.latency).count()<<"us"<<std::endl;
+    std::cout<<"received: "<<reader.received<<", task() calls in 350ms: "<<readerThread.nTasks<<std::endl;
+
+    readerThread.stop();
+    reader.removeFromThread();
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+    if(reader.received != "hello world" || reader.latency > std::chrono::milliseconds(50))
+        throw std::runtime_error("unexpected pipe result");
+
+    // echo server on a socketpair
+    EThread serverThread("server");
+    serverThread.setEpollEnabled(true);
+    EchoServer server;
+    server.moveToThread(serverThread);
+    int socketFds[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, socketFds) != 0)
+        throw std::runtime_error("socketpair() failed");
+    serverThread.watchFd(server, socketFds[0], EPOLLIN, [&server, fd = socketFds[0]](uint32_t events){ server.onReadable(fd, events); });
+    serverThread.start();
+
+    const int nRoundTrips = 1000;
+    startTime = std::chrono::high_resolution_clock::now();
+    for(int i=0; i<nRoundTrips; i++)
+    {
+        char buffer[8] = "ping";
+        write(socketFds[1], buffer, 4);
+        int nRead = 0;
+        while(nRead < 4)
+            nRead += (int)read(socketFds[1], buffer + nRead, 4 - nRead);
+    }
+    std::cout<<"socketpair echo round trip: "<<std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now() - startTime).count() / nRoundTrips<<"ns"<<std::endl;
+
+    // removing the EObject unwatches the fd
+    serverThread.stop();
+    server.removeFromThread();
+    close(socketFds[0]);
+    close(socketFds[1]);
+}
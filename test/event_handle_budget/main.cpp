@@ -0,0 +1,46 @@
+#include <ethread.h>
+
+using namespace ethr;
+
+class Worker : public EObject
+{
+public:
+    void work(int microseconds)
+    {
+        auto endTime = std::chrono::high_resolution_clock::now() + std::chrono::microseconds(microseconds);
+        while(std::chrono::high_resolution_clock::now() < endTime);
+    }
+};
+
+void runBurst(const std::string &name, const size_t &maxEvents, const std::chrono::nanoseconds &maxTime)
+{
+    EThread workerThread("worker");
+    workerThread.setLoopPeriod(std::chrono::milliseconds(1));
+    workerThread.setEventHandleBudget(maxEvents, maxTime);
+    Worker worker;
+    worker.moveToThread(workerThread);
+    workerThread.start();
+
+    // a burst of 1000 events of 20us. handled at once, it blocks task() for about 20ms
+    for(int i=0; i<1000; i++)
+        worker.callQueued(&Worker::work, 20);
+    workerThread.waitForEventHandleCompletion();
+
+    auto metrics = workerThread.metrics();
+    std::cout<<name
+        <<": handled="<<metrics.nHandledEvents
+        <<" loops="<<metrics.nLoops
+        <<" overruns="<<metrics.nLoopOverruns
+        <<" budgetExhaustions="<<metrics.nBudgetExhaustions
+        <<" busy time per loop="<<metrics.busyTime.count() / std::max<uint64_t>(metrics.nLoops, 1)<<"ns"<<std::endl;
+
+    workerThread.stop();
+    worker.removeFromThread();
+}
+
+int main()
+{
+    runBurst("no budget", 0, std::chrono::nanoseconds(0));
+    runBurst("20 events", 20, std::chrono::nanoseconds(0));
+    runBurst("500us", 0, std::chrono::microseconds(500));
+}
@@ -0,0 +1,58 @@
+#include <ethread.h>
+
+using namespace ethr;
+
+class Worker : public EObject
+{
+public:
+    void work(int microseconds)
+    {
+        auto endTime = std::chrono::high_resolution_clock::now() + std::chrono::microseconds(microseconds);
+        while(std::chrono::high_resolution_clock::now() < endTime);
+    }
+
+    void ping(std::chrono::high_resolution_clock::time_point queuedTime)
+    {
+        auto latency = std::chrono::high_resolution_clock::now() - queuedTime;
+        maxLatency = std::max(maxLatency, latency);
+    }
+
+    std::chrono::high_resolution_clock::duration maxLatency{0};
+};
+
+void run(const std::string &name, EThread::EventQueuePolicy policy)
+{
+    EThread workerThread("worker");
+    workerThread.setEventQueuePolicy(policy);
+    Worker noisy, quiet;
+    noisy.moveToThread(workerThread);
+    quiet.moveToThread(workerThread);
+    workerThread.setEObjectWeight(quiet, 2);
+    workerThread.start();
+
+    // the noisy EObject floods the thread with 20ms of work, while the quiet one is pinged every 2ms
+    for(int iRound=0; iRound<10; iRound++)
+    {
+        for(int i=0; i<400; i++)
+            noisy.callQueued(&Worker::work, 50);
+        for(int i=0; i<5; i++)
+        {
+            quiet.callQueued(&Worker::ping, std::chrono::high_resolution_clock::now());
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        workerThread.waitForEventHandleCompletion();
+    }
+
+    std::cout<<name<<": max latency of quiet EObject="
+        <<std::chrono::duration_cast<std::chrono::microseconds>(quiet.maxLatency).count()<<"us"<<std::endl;
+
+    workerThread.stop();
+    noisy.removeFromThread();
+    quiet.removeFromThread();
+}
+
+int main()
+{
+    run("FIFO", EThread::EventQueuePolicy::FIFO);
+    run("FAIR", EThread::EventQueuePolicy::FAIR);
+}
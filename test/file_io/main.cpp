@@ -0,0 +1,78 @@
+#include <ethread.h>
+#include <efileio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+
+using namespace ethr;
+
+class Recorder : public EObject
+{
+public:
+    void onWritten(ssize_t result)
+    {
+        if(result < 0)
+            std::cerr<<"write failed: "<<strerror((int)-result)<<std::endl;
+        else
+            nWrittenBytes += result;
+        nCompletions++;
+    }
+
+    std::atomic<long long> nWrittenBytes{0};
+    std::atomic<int> nCompletions{0};
+};
+
+void run(bool isIoUringAllowed)
+{
+    EThread recorderThread("recorder");
+    Recorder recorder;
+    recorder.moveToThread(recorderThread);
+    recorderThread.start();
+
+    EFileIo fileIo(16, 2, isIoUringAllowed);
+    std::cout<<(fileIo.backend() == EFileIo::Backend::IO_URING ? "io_uring" : "thread pool")<<std::endl;
+
+    // records written from a registered buffer at their offsets
+    const int nRecords = 64;
+    const size_t recordSize = 4096;
+    std::vector<char> buffer(nRecords * recordSize);
+    for(int i=0; i<nRecords; i++)
+        std::memset(buffer.data() + i * recordSize, 'a' + i % 26, recordSize);
+    fileIo.registerBuffers({{buffer.data(), buffer.size()}});
+
+    std::string path = "/tmp/event_thread_test_file_io_" + std::to_string(getpid());
+    int fd = open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if(fd < 0)
+        throw std::runtime_error("open() failed");
+    for(int i=0; i<nRecords; i++)
+        fileIo.write(fd, buffer.data() + i * recordSize, recordSize, (int64_t)(i * recordSize), recorder.ref<Recorder>(), &Recorder::onWritten);
+    fileIo.waitForCompletion();
+    recorderThread.waitForEventHandleCompletion();
+    std::cout<<"completions: "<<recorder.nCompletions<<", written: "<<recorder.nWrittenBytes<<" bytes"<<std::endl;
+
+    // read back to a plain buffer. the completion runs in the recorder thread
+    std::vector<char> readBuffer(buffer.size());
+    std::atomic<ssize_t> nReadBytes{0};
+    fileIo.read(fd, readBuffer.data(), readBuffer.size(), 0, recorder.uref(), [&](ssize_t result)
+    {
+        if(EThread::currentThread() != &recorderThread)
+            throw std::runtime_error("completion is not delivered to the EObject thread");
+        nReadBytes = result;
+    });
+    fileIo.waitForCompletion();
+    recorderThread.waitForEventHandleCompletion();
+    std::cout<<"read: "<<nReadBytes<<" bytes, "<<(readBuffer == buffer ? "matched" : "mismatched")<<std::endl;
+
+    recorderThread.stop();
+    recorder.removeFromThread();
+    close(fd);
+    unlink(path.c_str());
+    if(nReadBytes != (ssize_t)buffer.size() || readBuffer != buffer)
+        throw std::runtime_error("file content mismatch");
+}
+
+int main()
+{
+    run(true);
+    run(false);
+}
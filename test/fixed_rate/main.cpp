@@ -0,0 +1,115 @@
+#include <ethread.h>
+
+using namespace ethr;
+
+void checkRates(const std::string &name, EThread &ethread)
+{
+    std::atomic<int> nFastRuns{0}, nMediumRuns{0}, nSlowRuns{0};
+    std::atomic<int64_t> firstMediumRunNs{0};
+    std::chrono::high_resolution_clock::time_point startTime;
+    ethread.addFixedRateTask(std::chrono::milliseconds(1), [&]{ nFastRuns++; });
+    ethread.addFixedRateTask(std::chrono::milliseconds(10), [&]
+    {
+        if(nMediumRuns++ == 0)
+            firstMediumRunNs = (std::chrono::high_resolution_clock::now() - startTime).count();
+    }, std::chrono::milliseconds(3));
+    int slowId = ethread.addFixedRateTask(std::chrono::milliseconds(100), [&]{ nSlowRuns++; });
+
+    startTime = std::chrono::high_resolution_clock::now();
+    ethread.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    ethread.stop();
+
+    std::cout<<name<<": 1kHz "<<nFastRuns<<", 100Hz "<<nMediumRuns<<" (first at "<<firstMediumRunNs/1000<<"us), 10Hz "<<nSlowRuns<<std::endl;
+    for(auto &stats : ethread.fixedRateTaskStats())
+    {
+        std::cout<<"  task "<<stats.id<<": runs "<<stats.nRuns<<", overruns "<<stats.nOverruns<<", max lateness "
+                 <<stats.maxLateness.count()/1000<<"us"<<std::endl;
+    }
+    if(nFastRuns < 200 || nFastRuns > 510)
+        throw std::runtime_error(name + ": 1kHz task ran " + std::to_string(nFastRuns) + " times");
+    if(nMediumRuns < 20 || nMediumRuns > 51)
+        throw std::runtime_error(name + ": 100Hz task ran " + std::to_string(nMediumRuns) + " times");
+    if(nSlowRuns < 4 || nSlowRuns > 6)
+        throw std::runtime_error(name + ": 10Hz task ran " + std::to_string(nSlowRuns) + " times");
+    if(firstMediumRunNs < 3000000)
+        throw std::runtime_error(name + ": phase of 100Hz task is not kept");
+
+    if(!ethread.removeFixedRateTask(slowId) || ethread.fixedRateTaskStats().size() != 2)
+        throw std::runtime_error(name + ": fixed-rate task is not removed");
+}
+
+class Counter : public EObject
+{
+public:
+    void count()
+    {
+        nCalls++;
+    }
+
+    std::atomic<int> nCalls{0};
+};
+
+int main()
+{
+    EThread eventDriven("event_driven");
+    checkRates("event driven", eventDriven);
+
+    EThread periodic("periodic");
+    periodic.setEventDriven(false);
+    periodic.setLoopPeriod(std::chrono::milliseconds(50));
+    checkRates("periodic", periodic);
+
+    EThread epoll("epoll");
+    epoll.setEpollEnabled(true);
+    checkRates("epoll", epoll);
+
+    // a run longer than two periods skips the deadlines it missed instead of catching up
+    EThread overrun("overrun");
+    std::atomic<int> nOverrunRuns{0};
+    overrun.addFixedRateTask(std::chrono::milliseconds(10), [&]
+    {
+        nOverrunRuns++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(25));
+    });
+    overrun.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    overrun.stop();
+    auto stats = overrun.fixedRateTaskStats().front();
+    std::cout<<"overrun: runs "<<stats.nRuns<<", overruns "<<stats.nOverruns<<", skipped "<<stats.nSkippedRuns<<std::endl;
+    if(stats.nOverruns == 0 || stats.nSkippedRuns < stats.nOverruns || stats.nRuns > 13)
+        throw std::runtime_error("overrun task is not realigned");
+
+    // waking up for a fixed-rate task does not handle the events of a user-controlled loop
+    EThread userControlled("user_controlled");
+    userControlled.setEventHandleScheme(EThread::EventHandleScheme::USER_CONTROLLED);
+    userControlled.setLoopPeriod(std::chrono::milliseconds(100));
+    std::atomic<int> nUserControlledRuns{0};
+    userControlled.addFixedRateTask(std::chrono::milliseconds(1), [&]{ nUserControlledRuns++; });
+    Counter counter;
+    counter.moveToThread(userControlled);
+    for(int i=0; i<10; i++)
+        counter.callQueued(&Counter::count);
+    userControlled.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    userControlled.stop();
+    counter.removeFromThread();
+    std::cout<<"user controlled: fixed-rate runs "<<nUserControlledRuns<<", events handled "<<counter.nCalls<<std::endl;
+    if(nUserControlledRuns == 0 || counter.nCalls != 0)
+        throw std::runtime_error("user-controlled events are handled by the loop");
+
+    bool isThrown = false;
+    overrun.start();
+    try
+    {
+        overrun.addFixedRateTask(std::chrono::milliseconds(1), []{});
+    }
+    catch(std::runtime_error &error)
+    {
+        isThrown = true;
+    }
+    overrun.stop();
+    if(!isThrown)
+        throw std::runtime_error("fixed-rate task is added while running");
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include <ethread.h>
+#include <atomic>
+#include <iomanip>
+
+using namespace ethr;
+
+// Latency harness of cross-thread callQueued(). Usage:
+//   test_latency [--rate=<messages per second>] [--duration-ms=<milliseconds per run>]
+// The producer sends on a fixed schedule and every latency is measured from the scheduled send time,
+// so a stalled producer does not hide the delay it caused (coordinated omission correction).
+
+using Clock = std::chrono::high_resolution_clock;
+
+class Consumer : public EObject
+{
+public:
+    Consumer() : mNReceived(0){}
+    void received(Clock::time_point scheduledTime)
+    {
+        mLatency.record(Clock::now() - scheduledTime);
+        mNReceived.fetch_add(1, std::memory_order_relaxed);
+    }
+    ELatencyHistogram mLatency;
+    std::atomic<long long> mNReceived;
+};
+
+class Producer : public EThread
+{
+public:
+    Producer(const EObjectRef<Consumer> &consumerRef, const int &rate, const long long &nMessages)
+    : EThread("producer")
+    {
+        mConsumerRef = consumerRef;
+        mInterval = std::chrono::nanoseconds(1000000000 / rate);
+        mNMessages = nMessages;
+        mNSent = 0;
+    }
+protected:
+    void onStart() override
+    {
+        mStartTime = Clock::now();
+    }
+    void task() override
+    {
+        auto now = Clock::now();
+        // catch up on every message whose scheduled time has passed
+        while(mNSent < mNMessages && mStartTime + mInterval * mNSent <= now)
+        {
+            mConsumerRef.callQueued(&Consumer::received, Clock::time_point(mStartTime + mInterval * mNSent));
+            mNSent++;
+        }
+    }
+private:
+    EObjectRef<Consumer> mConsumerRef;
+    std::chrono::nanoseconds mInterval;
+    Clock::time_point mStartTime;
+    long long mNMessages;
+    long long mNSent;
+};
+
+struct LoopMode
+{
+    std::string name;
+    std::chrono::nanoseconds loopPeriod;
+    bool isEventDriven;
+    bool isEpollEnabled;
+};
+
+int main(int argc, char **argv)
+{
+    int rate = 10000;
+    int durationMs = 500;
+    for(int i=1; i<argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg.rfind("--rate=", 0) == 0)
+            rate = std::stoi(arg.substr(7));
+        else if(arg.rfind("--duration-ms=", 0) == 0)
+            durationMs = std::stoi(arg.substr(14));
+    }
+    long long nMessages = (long long)rate * durationMs / 1000;
+
+    int nCpus = (int)std::max(1u, std::thread::hardware_concurrency());
+    int producerCpu = 0;
+    int consumerCpu = 1 % nCpus;
+    std::cout<<"rate: "<<rate<<" msg/s, "<<nMessages<<" messages per run, producer on CPU "<<producerCpu
+        <<", consumer on CPU "<<consumerCpu<<std::endl;
+
+    std::vector<LoopMode> loopModes = {
+            {"period 1ms", std::chrono::milliseconds(1), false, false},
+            {"period 0", std::chrono::nanoseconds(0), false, false},
+            {"event-driven", std::chrono::nanoseconds(0), true, false},
+            {"event-driven period 1ms", std::chrono::milliseconds(1), true, false},
+#ifdef __linux__
+            {"epoll period 1ms", std::chrono::milliseconds(1), false, true},
+#endif
+    };
+    std::vector<std::pair<std::string, EThread::EventHandleScheme>> schemes = {
+            {"AFTER_TASK", EThread::EventHandleScheme::AFTER_TASK},
+            {"BEFORE_TASK", EThread::EventHandleScheme::BEFORE_TASK},
+    };
+
+    std::cout<<std::left<<std::setw(26)<<"loop mode"<<std::setw(13)<<"scheme"<<std::right;
+    for(const auto& header : {"p50[us]", "p90[us]", "p99[us]", "p999[us]", "p9999[us]", "max[us]", "lost"})
+        std::cout<<std::setw(11)<<header;
+    std::cout<<std::endl;
+
+    for(const auto& loopMode : loopModes)
+    {
+        for(const auto& scheme : schemes)
+        {
+            EThread consumerThread("consumer");
+            consumerThread.setLoopPeriod(loopMode.loopPeriod);
+            consumerThread.setEventDriven(loopMode.isEventDriven);
+            consumerThread.setEpollEnabled(loopMode.isEpollEnabled);
+            consumerThread.setEventHandleScheme(scheme.second);
+            consumerThread.setEventQueueSize(nMessages);
+            consumerThread.setCpuAffinity(consumerCpu);
+            Consumer consumer;
+            consumer.moveToThread(consumerThread);
+            consumerThread.start();
+
+            Producer producer(consumer.ref<Consumer>(), rate, nMessages);
+            producer.setLoopPeriod(std::chrono::nanoseconds(0));
+            producer.setCpuAffinity(producerCpu);
+            producer.start();
+
+            auto deadline = Clock::now() + std::chrono::milliseconds(durationMs) + std::chrono::seconds(2);
+            while(consumer.mNReceived < nMessages && Clock::now() < deadline)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            producer.stop();
+            consumerThread.stop();
+            consumer.removeFromThread();
+
+            auto latency = consumer.mLatency.snapshot();
+            std::cout<<std::left<<std::setw(26)<<loopMode.name<<std::setw(13)<<scheme.first<<std::right<<std::fixed<<std::setprecision(1);
+            for(double percent : {50.0, 90.0, 99.0, 99.9, 99.99})
+                std::cout<<std::setw(11)<<(double)latency.percentile(percent).count() / 1000.0;
+            std::cout<<std::setw(11)<<(double)latency.max().count() / 1000.0
+                <<std::setw(11)<<nMessages - consumer.mNReceived.load()<<std::endl;
+        }
+    }
+}
@@ -0,0 +1,174 @@
+#include <ethread.h>
+#include <ebalancer.h>
+
+using namespace ethr;
+
+class Worker : public EObject
+{
+public:
+    void block(std::chrono::milliseconds duration)
+    {
+        std::this_thread::sleep_for(duration);
+    }
+
+    void record(int sequence)
+    {
+        sequences.push_back(sequence);
+        threads.push_back(EThread::currentThread());
+    }
+
+    void spin(std::chrono::microseconds duration)
+    {
+        auto endTime = std::chrono::high_resolution_clock::now() + duration;
+        while(std::chrono::high_resolution_clock::now() < endTime);
+        lastThread = EThread::currentThread();
+        nCalls++;
+    }
+
+    std::vector<int> sequences;
+    EThread *affinity()
+    {
+        return threadInAffinity();
+    }
+
+    std::vector<EThread*> threads;
+    std::atomic<EThread*> lastThread{nullptr};
+    std::atomic<int> nCalls{0};
+};
+
+int main()
+{
+    EThread sourceThread("source"), targetThread("target");
+    std::vector<EThread*> ethreads{&sourceThread, &targetThread};
+    for(auto* ethreadPtr : ethreads)
+        ethreadPtr->setEventQueueSize(10000);
+
+    // the events queued before and after the migration are handled in order in the target
+    Worker blocker, worker;
+    EObject::moveToThread({&blocker, &worker}, sourceThread);
+    EThread::startAll(ethreads);
+    auto workerRef = worker.ref<Worker>();
+    blocker.callQueued(&Worker::block, std::chrono::milliseconds(50));
+    for(int i=0; i<100; i++)
+        workerRef.callQueued(&Worker::record, i);
+    worker.migrateToThread(targetThread);
+    for(int i=100; i<200; i++)
+        workerRef.callQueued(&Worker::record, i);
+    EThread::waitForQuiescence(ethreads);
+
+    bool isInOrder = worker.sequences.size() == 200;
+    for(size_t i=0; isInOrder && i<worker.sequences.size(); i++)
+        isInOrder = worker.sequences[i] == (int)i && worker.threads[i] == &targetThread;
+    std::cout<<"migrated events handled: "<<worker.sequences.size()<<", in order in the target: "<<isInOrder<<std::endl;
+    if(!isInOrder)
+        throw std::runtime_error("events are lost or reordered by the migration");
+    EThread::stopAll(ethreads);
+    EObject::removeFromThread({&blocker, &worker});
+
+    // a pending coalesced call goes along with the migration. it is replaced by later posts in the target,
+    // and does not refer to the source after that is destroyed
+    {
+        auto coalescedSourcePtr = std::make_unique<EThread>("coalesced_source");
+        EThread coalescedTarget("coalesced_target");
+        Worker coalescedBlocker, coalescedWorker;
+        EObject::moveToThread({&coalescedBlocker, &coalescedWorker}, *coalescedSourcePtr);
+        coalescedSourcePtr->start();
+        coalescedBlocker.callQueued(&Worker::block, std::chrono::milliseconds(20));
+        coalescedWorker.callQueuedCoalesced(&Worker::record, 1);
+        coalescedWorker.migrateToThread(coalescedTarget);
+        while(coalescedWorker.affinity() != &coalescedTarget)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        coalescedSourcePtr->stop();
+        coalescedBlocker.removeFromThread();
+        coalescedSourcePtr.reset();
+
+        coalescedWorker.callQueuedCoalesced(&Worker::record, 2);
+        coalescedTarget.start();
+        EThread::waitForQuiescence({&coalescedTarget});
+        coalescedTarget.stop();
+        coalescedWorker.removeFromThread();
+        std::cout<<"coalesced calls handled after the migration: "<<coalescedWorker.sequences.size()<<std::endl;
+        if(coalescedWorker.sequences != std::vector<int>{2})
+            throw std::runtime_error("coalesced call is not carried over by the migration");
+    }
+
+    // four busy EObjects in one EThread are spread over the two
+    EThread busyThread("busy"), idleThread("idle");
+    ethreads = {&busyThread, &idleThread};
+    Worker workers[4];
+    ELoadBalancer balancer(ethreads, 0.1);
+    balancer.pin(workers[0]);
+    EObject::moveToThread({&workers[0], &workers[1], &workers[2], &workers[3]}, busyThread);
+    EThread::startAll(ethreads);
+    for(int round=0; round<6; round++)
+    {
+        for(int i=0; i<20; i++)
+        {
+            for(auto& eachWorker : workers)
+                eachWorker.ref<Worker>().callQueued(&Worker::spin, std::chrono::microseconds(200));
+        }
+        EThread::waitForQuiescence(ethreads);
+        balancer.rebalance();
+    }
+    EThread::waitForQuiescence(ethreads);
+
+    int nIdleThreadWorkers = 0;
+    for(auto& eachWorker : workers)
+        nIdleThreadWorkers += eachWorker.lastThread == &idleThread;
+    std::cout<<"migrations: "<<balancer.nMigrations()<<", workers in the idle thread: "<<nIdleThreadWorkers<<std::endl;
+    if(nIdleThreadWorkers == 0 || workers[0].lastThread != &busyThread || workers[0].nCalls != 120)
+        throw std::runtime_error("unexpected balancing");
+
+    EThread::stopAll(ethreads);
+    EObject::removeFromThread({&workers[0], &workers[1], &workers[2], &workers[3]});
+
+    // EObjects waiting behind a blocked handler have handled nothing since the last rebalance,
+    // and are weighed by their queued events at their mean handler time of the earlier rebalances
+    EThread blockedThread("blocked"), freeThread("free");
+    ethreads = {&blockedThread, &freeThread};
+    Worker blockedBlocker, waiters[2], freeWorker;
+    ELoadBalancer backlogBalancer(ethreads, 0.5);
+    backlogBalancer.pin(blockedBlocker);
+    EObject::moveToThread({&blockedBlocker, &waiters[0], &waiters[1]}, blockedThread);
+    freeWorker.moveToThread(freeThread);
+    EThread::startAll(ethreads);
+    for(int i=0; i<5; i++)
+    {
+        for(auto& waiter : waiters)
+            waiter.ref<Worker>().callQueued(&Worker::spin, std::chrono::microseconds(1000));
+    }
+    for(int i=0; i<10; i++)
+        freeWorker.ref<Worker>().callQueued(&Worker::spin, std::chrono::microseconds(1000));
+    EThread::waitForQuiescence(ethreads);
+    if(backlogBalancer.rebalance() != -1)
+        throw std::runtime_error("balanced EThreads are rebalanced");
+
+    blockedBlocker.callQueued(&Worker::block, std::chrono::milliseconds(200));
+    for(int i=0; i<25; i++)
+    {
+        for(auto& waiter : waiters)
+            waiter.ref<Worker>().callQueued(&Worker::spin, std::chrono::microseconds(1000));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    int backlogMigratedId = backlogBalancer.rebalance();
+    std::cout<<"EObject migrated for its backlog: "<<backlogMigratedId<<std::endl;
+    if(backlogMigratedId != waiters[0].id() && backlogMigratedId != waiters[1].id())
+        throw std::runtime_error("backlog of EObjects without handled events is not weighed");
+    EThread::waitForQuiescence(ethreads);
+    EThread::stopAll(ethreads);
+    EObject::removeFromThread({&blockedBlocker, &waiters[0], &waiters[1], &freeWorker});
+
+    // load tracking is not enabled on a running EThread
+    EThread runningThread("running");
+    runningThread.start();
+    try
+    {
+        ELoadBalancer lateBalancer({&runningThread});
+        throw std::logic_error("balancer of a running EThread is constructed");
+    }
+    catch(const std::runtime_error &e)
+    {
+        std::cout<<"balancer of a running EThread: "<<e.what()<<std::endl;
+    }
+    runningThread.stop();
+}
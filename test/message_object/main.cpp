@@ -0,0 +1,97 @@
+#include <ethread.h>
+#include <emessage.h>
+
+using namespace ethr;
+
+struct SetSpeed
+{
+    int speed;
+};
+
+struct Rename
+{
+    std::string name;
+};
+
+struct Stop
+{
+};
+
+class Motor : public EMessageObject<Motor, SetSpeed, Rename, Stop>
+{
+public:
+    void onMessage(SetSpeed &message)
+    {
+        speedSum += message.speed;
+        nMessages++;
+    }
+
+    void onMessage(Rename &message)
+    {
+        name = std::move(message.name);
+        nMessages++;
+    }
+
+    void onMessage(Stop &)
+    {
+        isStopped = true;
+        nMessages++;
+    }
+
+    long long speedSum = 0;
+    std::string name;
+    bool isStopped = false;
+    std::atomic<int> nMessages{0};
+};
+
+int main()
+{
+    EThread workerThread("worker");
+    workerThread.start();
+
+    Motor motor;
+    motor.moveToThread(workerThread);
+    auto motorRef = motor.ref<Motor>();
+
+    std::thread producer([&]
+    {
+        for(int i=1; i<=1000; i++)
+            motorRef.post(SetSpeed{i});
+    });
+    for(int i=1; i<=1000; i++)
+        motor.post(SetSpeed{-i});
+    producer.join();
+    motorRef.post(Rename{"left"});
+    motor.post(Stop{});
+    workerThread.waitForEventHandleCompletion();
+    std::cout<<"messages: "<<motor.nMessages<<", speed sum: "<<motor.speedSum<<", name: "<<motor.name
+        <<", stopped: "<<motor.isStopped<<std::endl;
+    if(motor.nMessages != 2002 || motor.speedSum != 0 || motor.name != "left" || !motor.isStopped)
+        throw std::runtime_error("unexpected message handling");
+
+    // messages over the queue size are rejected
+    workerThread.stop();
+    motor.setMessageQueueSize(4);
+    int nAccepted = 0;
+    for(int i=0; i<10; i++)
+        nAccepted += motor.post(SetSpeed{1});
+    std::cout<<"accepted with queue size 4: "<<nAccepted<<std::endl;
+    if(nAccepted != 4)
+        throw std::runtime_error("unexpected message queue size");
+
+    // the messages left by the drain dropped on removal are handled with the ones posted after the move back
+    motor.removeFromThread();
+    motor.moveToThread(workerThread);
+    motor.setMessageQueueSize(65536);
+    workerThread.start();
+    motor.post(SetSpeed{1});
+    workerThread.waitForEventHandleCompletion();
+    std::cout<<"messages after moving back: "<<motor.nMessages<<std::endl;
+    if(motor.nMessages != 2007)
+        throw std::runtime_error("messages are lost after moving back");
+
+    workerThread.stop();
+    motor.removeFromThread();
+    if(motorRef.post(Stop{}))
+        throw std::runtime_error("post to a removed EObject is accepted");
+}
@@ -0,0 +1,67 @@
+#include <ethread.h>
+
+using namespace ethr;
+
+class Worker : public EObject
+{
+public:
+    void work(int microseconds)
+    {
+        auto endTime = std::chrono::high_resolution_clock::now() + std::chrono::microseconds(microseconds);
+        while(std::chrono::high_resolution_clock::now() < endTime);
+    }
+};
+
+void printLatency(const std::string &name, const ELatencyHistogram::Snapshot &latency)
+{
+    std::cout<<name<<": count="<<latency.count()
+        <<" mean="<<latency.mean().count()<<"ns"
+        <<" p50="<<latency.percentile(50).count()<<"ns"
+        <<" p99="<<latency.percentile(99).count()<<"ns"
+        <<" p999="<<latency.percentile(99.9).count()<<"ns"
+        <<" max="<<latency.max().count()<<"ns"<<std::endl;
+}
+
+int main()
+{
+    EThread workerThread("worker");
+    workerThread.setEventQueueSize(100);
+    Worker worker;
+    worker.moveToThread(workerThread);
+    workerThread.start();
+
+    // bursts of 200 events on a 1ms loop. half of each burst is dropped by the event queue size
+    for(int iBurst=0; iBurst<20; iBurst++)
+    {
+        for(int i=0; i<200; i++)
+            worker.callQueued(&Worker::work, 10);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    workerThread.waitForEventHandleCompletion();
+
+    auto metrics = workerThread.metrics();
+    std::cout<<"queued="<<metrics.nQueuedEvents
+        <<" dropped="<<metrics.nDroppedEvents
+        <<" handled="<<metrics.nHandledEvents
+        <<" loops="<<metrics.nLoops
+        <<" overruns="<<metrics.nLoopOverruns
+        <<" depth="<<metrics.eventQueueDepth
+        <<" maxDepth="<<metrics.maxEventQueueDepth
+        <<" utilization="<<metrics.utilization()<<std::endl;
+    printLatency("queue latency", metrics.queueLatency);
+    printLatency("handle latency", metrics.handleLatency);
+    printLatency("task latency", metrics.taskLatency);
+
+    // the running loop applies the reset on its next iteration. at most the event below is counted
+    workerThread.resetMetrics();
+    worker.callQueued(&Worker::work, 10);
+    workerThread.waitForEventHandleCompletion();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    metrics = workerThread.metrics();
+    std::cout<<"handled after reset="<<metrics.nHandledEvents<<std::endl;
+    if(metrics.nHandledEvents > 1 || metrics.handleLatency.count() > 1)
+        throw std::runtime_error("metrics are not reset on the running loop");
+
+    workerThread.stop();
+    worker.removeFromThread();
+}
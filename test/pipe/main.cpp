@@ -0,0 +1,83 @@
+#include <ethread.h>
+#include <epipe.h>
+#include <atomic>
+
+using namespace ethr;
+
+class Worker : public EObject
+{
+public:
+    Worker() : mNReceived(0){}
+    void work(std::vector<int> &&)
+    {
+        mNReceived.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::atomic<int> mNReceived;
+};
+
+template<typename Push>
+double measureItemsPerSec(Worker &worker, const int &nItems, Push push)
+{
+    worker.mNReceived = 0;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for(int i=0; i<nItems; i++)
+    {
+        while(!push(std::vector<int>(16, i)))
+            std::this_thread::yield();
+    }
+    while(worker.mNReceived.load(std::memory_order_relaxed) < nItems)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+    return nItems / elapsed.count();
+}
+
+// a drain dropped by a full event queue must not keep the pipe from queueing the next one
+void checkDroppedDrain()
+{
+    EThread workerThread("dropped_drain");
+    workerThread.setEventQueueSize(1);
+    Worker worker;
+    worker.moveToThread(workerThread);
+    worker.callQueuedMove(&Worker::work, std::vector<int>());
+
+    EPipe<std::vector<int>> pipe(worker.ref<Worker>(), &Worker::work, 16);
+    pipe.push(std::vector<int>(16, 0));
+    workerThread.setEventQueueSize(16);
+    pipe.push(std::vector<int>(16, 1));
+    workerThread.start();
+    for(int i=0; i<100 && worker.mNReceived < 3; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    workerThread.stop();
+    worker.removeFromThread();
+    if(worker.mNReceived != 3)
+        throw std::runtime_error("EPipe stalled after a dropped drain. received " + std::to_string(worker.mNReceived));
+}
+
+int main()
+{
+    checkDroppedDrain();
+
+    const int nItems = 1 << 20;
+    EThread workerThread("worker");
+    workerThread.setLoopPeriod(std::chrono::milliseconds(0));
+    workerThread.setEventQueueSize(nItems);
+    Worker worker;
+    worker.moveToThread(workerThread);
+    workerThread.start();
+    auto workerRef = worker.ref<Worker>();
+
+    EPipe<std::vector<int>> pipe(workerRef, &Worker::work, 4096);
+    double pipeRate = measureItemsPerSec(worker, nItems, [&](std::vector<int> &&numbers)
+    {
+        return pipe.push(std::move(numbers));
+    });
+    double callQueuedRate = measureItemsPerSec(worker, nItems, [&](std::vector<int> &&numbers)
+    {
+        return workerRef.callQueuedMove(&Worker::work, std::move(numbers));
+    });
+    std::cout<<"EPipe::push(): "<<pipeRate<<" items/s"<<std::endl;
+    std::cout<<"EObjectRef::callQueuedMove(): "<<callQueuedRate<<" items/s"<<std::endl;
+
+    workerThread.stop();
+    worker.removeFromThread();
+}
@@ -0,0 +1,96 @@
+#include <ethread.h>
+#include <eutil.h>
+#include <atomic>
+
+using namespace ethr;
+
+// reads a lookup table from nReaders threads while a writer updates it every millisecond
+template<typename SharedTable>
+double measureReadsPerSec(SharedTable table, const int &nReaders)
+{
+    std::atomic<bool> isRunning(true);
+    std::atomic<long long> nReads(0);
+    std::atomic<long long> nInconsistentReads(0);
+
+    std::vector<std::thread> readers;
+    for(int i=0; i<nReaders; i++)
+    {
+        readers.emplace_back([&, table]()mutable
+        {
+            long long nReadsHere = 0;
+            while(isRunning.load(std::memory_order_relaxed))
+            {
+                table.readOnly([&](typename SharedTable::ReadOnlyPtr tablePtr)
+                {
+                    if(tablePtr->at(0) != tablePtr->at(99))
+                        nInconsistentReads++;
+                });
+                nReadsHere++;
+            }
+            nReads += nReadsHere;
+        });
+    }
+    std::thread writer([&, table]()mutable
+    {
+        for(int version = 1; isRunning.load(std::memory_order_relaxed); version++)
+        {
+            table.readWrite([&](typename SharedTable::ReadWritePtr tablePtr)
+            {
+                for(auto & pair : *tablePtr)
+                    pair.second = version;
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    auto duration = std::chrono::milliseconds(500);
+    std::this_thread::sleep_for(duration);
+    isRunning = false;
+    for(auto & reader : readers)
+        reader.join();
+    writer.join();
+
+    if(nInconsistentReads != 0)
+        std::cerr<<"inconsistent reads detected: "<<nInconsistentReads<<std::endl;
+    return nReads / std::chrono::duration<double>(duration).count();
+}
+
+// each instance keeps its own cached snapshot, and a nested read after a publish does not release the outer one
+void checkSnapshots()
+{
+    static_assert(std::is_reference_v<RcuSharedPtr<int>::ReadOnlyPtr>, "readOnly() copies the snapshot pointer");
+    RcuSharedPtr<int> first(std::make_shared<int>(1));
+    RcuSharedPtr<int> second(std::make_shared<int>(2));
+    for(int i=0; i<3; i++)
+    {
+        first.readOnly([](RcuSharedPtr<int>::ReadOnlyPtr valuePtr){ if(*valuePtr != 1) throw std::runtime_error("wrong snapshot of first"); });
+        second.readOnly([](RcuSharedPtr<int>::ReadOnlyPtr valuePtr){ if(*valuePtr != 2) throw std::runtime_error("wrong snapshot of second"); });
+    }
+
+    first.readOnly([&](RcuSharedPtr<int>::ReadOnlyPtr outerPtr)
+    {
+        first.readWrite([](RcuSharedPtr<int>::ReadWritePtr valuePtr){ *valuePtr = 3; });
+        first.readOnly([](RcuSharedPtr<int>::ReadOnlyPtr innerPtr){ if(*innerPtr != 3) throw std::runtime_error("nested read is outdated"); });
+        if(*outerPtr != 1)
+            throw std::runtime_error("outer snapshot changed");
+    });
+    if(*first.snapshot() != 3)
+        throw std::runtime_error("publish is not seen");
+}
+
+int main()
+{
+    checkSnapshots();
+
+    auto table = std::make_shared<std::map<int, int>>();
+    for(int i=0; i<100; i++)
+        table->insert({i, 0});
+
+    std::cout<<"readers, SafeSharedPtr [reads/s], RcuSharedPtr [reads/s]"<<std::endl;
+    for(int nReaders : {1, 2, 4, 8})
+    {
+        double safeRate = measureReadsPerSec(SafeSharedPtr<std::map<int, int>>(std::make_shared<std::map<int, int>>(*table)), nReaders);
+        double rcuRate = measureReadsPerSec(RcuSharedPtr<std::map<int, int>>(std::make_shared<std::map<int, int>>(*table)), nReaders);
+        std::cout<<nReaders<<", "<<safeRate<<", "<<rcuRate<<std::endl;
+    }
+}
@@ -0,0 +1,49 @@
+#include <ethread.h>
+
+using namespace ethr;
+
+class Counter : public EObject
+{
+public:
+    void count()
+    {
+        nCounts++;
+    }
+
+    int nCounts = 0;
+};
+
+int main()
+{
+    EThread workerThread("worker");
+    workerThread.setEventQueueSize(1000000);
+    Counter counter, other;
+    counter.moveToThread(workerThread);
+    other.moveToThread(workerThread);
+
+    // removing an EObject does not scan the events queued before it
+    for(int i=0; i<500000; i++)
+    {
+        counter.callQueued(&Counter::count);
+        other.callQueued(&Counter::count);
+    }
+    auto startTime = std::chrono::high_resolution_clock::now();
+    counter.removeFromThread();
+    auto elapsed = std::chrono::high_resolution_clock::now() - startTime;
+    std::cout<<"removeFromThread() with 1000000 queued events took "
+        <<std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()<<"us"<<std::endl;
+
+    // events queued before the removal are not handled even if the EObject is moved back
+    counter.moveToThread(workerThread);
+    counter.callQueued(&Counter::count);
+    workerThread.start();
+    workerThread.waitForEventHandleCompletion();
+    std::cout<<"counter: "<<counter.nCounts<<", other: "<<other.nCounts<<std::endl;
+
+    workerThread.stop();
+    counter.removeFromThread();
+    other.removeFromThread();
+
+    if(counter.nCounts != 1 || other.nCounts != 500000)
+        throw std::runtime_error("events of a removed EObject were handled");
+}
@@ -0,0 +1,65 @@
+#include <ethread.h>
+#include <eutil.h>
+#include <atomic>
+
+using namespace ethr;
+
+// every writer thread updates its own range of keys for a fixed duration
+template<typename Write>
+double measureWritesPerSec(const int &nWriters, Write write)
+{
+    std::atomic<bool> isRunning(true);
+    std::atomic<long long> nWrites(0);
+    std::vector<std::thread> writers;
+    for(int iWriter=0; iWriter<nWriters; iWriter++)
+    {
+        writers.emplace_back([&, iWriter]
+        {
+            long long nWritesHere = 0;
+            while(isRunning.load(std::memory_order_relaxed))
+                write(iWriter * 1000 + (int)(nWritesHere++ % 1000));
+            nWrites += nWritesHere;
+        });
+    }
+    auto duration = std::chrono::milliseconds(500);
+    std::this_thread::sleep_for(duration);
+    isRunning = false;
+    for(auto & writer : writers)
+        writer.join();
+    return nWrites / std::chrono::duration<double>(duration).count();
+}
+
+int main()
+{
+    std::cout<<"writers, SafeSharedPtr<unordered_map> [writes/s], SafeHashMap [writes/s], SafeAppendLog [writes/s]"<<std::endl;
+    for(int nWriters : {1, 2, 4, 8})
+    {
+        SafeSharedPtr<std::unordered_map<int, int>> singleMutexMap(std::make_shared<std::unordered_map<int, int>>());
+        double singleMutexRate = measureWritesPerSec(nWriters, [&](int key)
+        {
+            singleMutexMap.readWrite([&](SafeSharedPtr<std::unordered_map<int, int>>::ReadWritePtr mapPtr)
+            {
+                (*mapPtr)[key]++;
+            });
+        });
+
+        SafeHashMap<int, int> stripedMap;
+        double stripedRate = measureWritesPerSec(nWriters, [&](int key)
+        {
+            stripedMap.readWrite(key, [&](SafeHashMap<int, int>::ReadWritePtr mapPtr)
+            {
+                (*mapPtr)[key]++;
+            });
+        });
+
+        SafeAppendLog<int> log;
+        double logRate = measureWritesPerSec(nWriters, [&](int key)
+        {
+            log.append(key);
+        });
+        if(log.entries().size() != log.size())
+            std::cerr<<"SafeAppendLog lost entries"<<std::endl;
+
+        std::cout<<nWriters<<", "<<singleMutexRate<<", "<<stripedRate<<", "<<logRate<<std::endl;
+    }
+}
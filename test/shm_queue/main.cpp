@@ -0,0 +1,120 @@
+#include <ethread.h>
+#include <eshm.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace ethr;
+
+struct Sample
+{
+    int index;
+    double value;
+};
+
+enum MessageId : uint32_t
+{
+    SAMPLE,
+    LOG,
+};
+
+class Recorder : public EObject
+{
+public:
+    void onSample(Sample &&sample)
+    {
+        if(sample.index != nSamples)
+            std::cerr<<"out of order sample "<<sample.index<<std::endl;
+        sum += sample.value;
+        nSamples++;
+    }
+
+    void onLog(std::string &&log)
+    {
+        logs.push_back(std::move(log));
+    }
+
+    std::atomic<int> nSamples{0};
+    double sum = 0;
+    std::vector<std::string> logs;
+};
+
+int main()
+{
+    const int nSamples = 100000;
+    std::string name = "/event_thread_test_shm_" + std::to_string(getpid());
+
+    // the producer process posts through a proxy, retrying until the receiver has created the queue
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+        std::unique_ptr<EShmProxy> proxyPtr;
+        while(!proxyPtr)
+        {
+            try
+            {
+                proxyPtr = std::make_unique<EShmProxy>(name);
+            }
+            catch(const std::runtime_error &)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        proxyPtr->post(LOG, std::string("producer started"));
+        for(int i=0; i<nSamples; i++)
+        {
+            while(!proxyPtr->post(SAMPLE, Sample{i, 0.5}))
+                std::this_thread::yield();
+        }
+        proxyPtr->post(LOG, std::string("producer finished"));
+        _exit(0);
+    }
+
+    EThread recorderThread("recorder");
+    Recorder recorder;
+    recorder.moveToThread(recorderThread);
+    recorderThread.start();
+    {
+        EShmReceiver receiver(name, recorder.uref(), 1024, 64);
+        receiver.handle(SAMPLE, recorder.ref<Recorder>(), &Recorder::onSample);
+        receiver.handle(LOG, recorder.ref<Recorder>(), &Recorder::onLog);
+        receiver.start();
+
+        waitpid(pid, nullptr, 0);
+        auto startTime = std::chrono::high_resolution_clock::now();
+        while(recorder.nSamples < nSamples && std::chrono::high_resolution_clock::now() - startTime < std::chrono::seconds(5))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        recorderThread.waitForEventHandleCompletion();
+    }
+    recorderThread.stop();
+    recorder.removeFromThread();
+
+    std::cout<<"samples: "<<recorder.nSamples<<", sum: "<<recorder.sum<<std::endl;
+    for(const auto& log : recorder.logs)
+        std::cout<<"log: "<<log<<std::endl;
+    if(recorder.nSamples != nSamples || recorder.logs.size() != 2)
+        throw std::runtime_error("messages are lost");
+
+    // a drain dropped by a full event queue is queued again once the queue has room
+    EThread fullThread("full");
+    fullThread.setEventQueueSize(1);
+    Recorder fullRecorder;
+    fullRecorder.moveToThread(fullThread);
+    fullRecorder.callQueuedMove(&Recorder::onLog, std::string("pending"));
+    {
+        EShmReceiver receiver(name, fullRecorder.uref(), 64, 64);
+        receiver.handle(SAMPLE, fullRecorder.ref<Recorder>(), &Recorder::onSample);
+        receiver.start();
+        EShmProxy proxy(name);
+        for(int i=0; i<11; i++)
+            proxy.post(SAMPLE, Sample{i, 1.0});
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        fullThread.start();
+        for(int i=0; i<1000 && fullRecorder.nSamples < 11; i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    fullThread.stop();
+    fullRecorder.removeFromThread();
+    std::cout<<"samples after a dropped drain: "<<fullRecorder.nSamples<<std::endl;
+    if(fullRecorder.nSamples != 11)
+        throw std::runtime_error("receiver stalled after a dropped drain");
+}
@@ -0,0 +1,87 @@
+#include <ethread.h>
+
+using namespace ethr;
+
+class Worker : public EObject
+{
+public:
+    void work()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        nCalls++;
+    }
+
+    // forwards a token around the ring of stages until the hops run out
+    void forward(int nHops)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        nCalls++;
+        if(nHops > 0)
+            mNext.callQueued(&Worker::forward, nHops - 1);
+    }
+
+    EObjectRef<Worker> mNext;
+    std::atomic<int> nCalls{0};
+};
+
+size_t stopWithQueuedWork(EThread::StopMode mode, std::chrono::nanoseconds drainTimeout, int &nHandled)
+{
+    EThread ethread("worker");
+    ethread.setEventQueueSize(1000);
+    Worker worker;
+    worker.moveToThread(ethread);
+    for(int i=0; i<50; i++)
+        worker.callQueued(&Worker::work);
+    ethread.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    size_t nDiscarded = ethread.stop(mode, drainTimeout);
+    nHandled = worker.nCalls;
+    worker.removeFromThread();
+    return nDiscarded;
+}
+
+int main()
+{
+    int nHandled;
+    size_t nDiscarded = stopWithQueuedWork(EThread::StopMode::DRAIN, std::chrono::nanoseconds(0), nHandled);
+    std::cout<<"DRAIN: handled "<<nHandled<<", discarded "<<nDiscarded<<std::endl;
+    if(nHandled != 50 || nDiscarded != 0)
+        throw std::runtime_error("DRAIN left events");
+
+    nDiscarded = stopWithQueuedWork(EThread::StopMode::DRAIN_UNTIL, std::chrono::milliseconds(10), nHandled);
+    std::cout<<"DRAIN_UNTIL 10ms: handled "<<nHandled<<", discarded "<<nDiscarded<<std::endl;
+    if(nHandled + nDiscarded != 50 || nDiscarded == 0)
+        throw std::runtime_error("DRAIN_UNTIL did not stop at the deadline");
+
+    nDiscarded = stopWithQueuedWork(EThread::StopMode::DISCARD, std::chrono::nanoseconds(0), nHandled);
+    std::cout<<"DISCARD: handled "<<nHandled<<", discarded "<<nDiscarded<<std::endl;
+    if(nHandled + nDiscarded != 50 || nDiscarded < 40)
+        throw std::runtime_error("DISCARD handled the queued events");
+
+    // a token passed around three EThreads. each queue is empty at some point before the last hop
+    EThread ethreads[3];
+    Worker workers[3];
+    for(int i=0; i<3; i++)
+    {
+        ethreads[i].setEventDriven(true);
+        workers[i].moveToThread(ethreads[i]);
+    }
+    for(int i=0; i<3; i++)
+        workers[i].mNext = workers[(i + 1) % 3].ref<Worker>();
+    std::vector<EThread*> ethreadPtrs{&ethreads[0], &ethreads[1], &ethreads[2]};
+    EThread::startAll(ethreadPtrs);
+
+    workers[0].callQueued(&Worker::forward, 299);
+    if(EThread::waitForQuiescence(ethreadPtrs, std::chrono::milliseconds(1)))
+        throw std::runtime_error("quiescent while the token is in flight");
+    if(!EThread::waitForQuiescence(ethreadPtrs, std::chrono::seconds(10)))
+        throw std::runtime_error("quiescence timed out");
+    int nHops = workers[0].nCalls + workers[1].nCalls + workers[2].nCalls;
+    std::cout<<"hops handled on quiescence: "<<nHops<<std::endl;
+    if(nHops != 300)
+        throw std::runtime_error("quiescence reported with events in flight");
+
+    EThread::stopAll(ethreadPtrs);
+    for(auto &worker : workers)
+        worker.removeFromThread();
+}
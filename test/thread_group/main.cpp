@@ -0,0 +1,104 @@
+#include <ethread.h>
+
+using namespace ethr;
+
+class Worker : public EThread
+{
+public:
+    using EThread::EThread;
+    std::atomic<bool> isStarted{false};
+protected:
+    void onStart() override
+    {
+        isStarted = true;
+    }
+};
+
+class Counter : public EObject
+{
+public:
+    void count()
+    {
+        nCalls++;
+    }
+    std::atomic<int> nCalls{0};
+};
+
+void printReport(const std::string &title, const EThread::LifecycleReport &report)
+{
+    auto slowest = std::max_element(report.threadTimes.begin(), report.threadTimes.end(),
+                                    [](const auto &a, const auto &b){ return a.second < b.second; });
+    std::cout<<title<<" of "<<report.threadTimes.size()<<" threads took "
+        <<std::chrono::duration_cast<std::chrono::microseconds>(report.totalTime).count()<<"us, the slowest is "
+        <<slowest->first<<" at "<<std::chrono::duration_cast<std::chrono::microseconds>(slowest->second).count()<<"us"<<std::endl;
+}
+
+int main()
+{
+    const int nThreads = 16;
+    const int nEObjectsPerThread = 64;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<EThread*> ethreads;
+    for(int i=0; i<nThreads; i++)
+    {
+        workers.push_back(std::make_unique<Worker>("worker" + std::to_string(i)));
+        ethreads.push_back(workers.back().get());
+    }
+
+    std::vector<Counter> counters(nThreads * nEObjectsPerThread);
+    for(int i=0; i<nThreads; i++)
+    {
+        std::vector<EObject*> eObjects;
+        for(int j=0; j<nEObjectsPerThread; j++)
+            eObjects.push_back(&counters[i * nEObjectsPerThread + j]);
+        EObject::moveToThread(eObjects, *workers[i]);
+    }
+
+    // a thread already running and a thread listed twice are not waited for
+    EThread::startAll({workers[0].get()});
+    std::vector<EThread*> group = ethreads;
+    group.push_back(ethreads[1]);
+    auto startReport = EThread::startAll(group);
+    printReport("startAll", startReport);
+    for(auto &worker : workers)
+    {
+        if(!worker->isStarted)
+            throw std::runtime_error("startAll() returned before onStart()");
+    }
+    if(startReport.threadTimes.size() != nThreads + 1)
+        throw std::runtime_error("unexpected start report");
+
+    for(auto &counter : counters)
+        counter.callQueued(&Counter::count);
+    for(auto &worker : workers)
+        worker->waitForEventHandleCompletion();
+
+    // the EObjects of the first thread are moved to the second as a group
+    std::vector<EObject*> movedEObjects;
+    for(int j=0; j<nEObjectsPerThread; j++)
+        movedEObjects.push_back(&counters[j]);
+    EObject::moveToThread(movedEObjects, *workers[1]);
+    for(auto *eObjectPtr : movedEObjects)
+    {
+        auto *counterPtr = (Counter*)eObjectPtr;
+        counterPtr->callQueued(&Counter::count);
+    }
+    workers[1]->waitForEventHandleCompletion();
+
+    int nCalls = 0;
+    for(auto &counter : counters)
+        nCalls += counter.nCalls;
+    std::cout<<"calls handled: "<<nCalls<<std::endl;
+    if(nCalls != nThreads * nEObjectsPerThread + nEObjectsPerThread)
+        throw std::runtime_error("unexpected number of calls");
+
+    auto stopReport = EThread::stopAll(ethreads);
+    printReport("stopAll", stopReport);
+
+    std::vector<EObject*> eObjects;
+    for(auto &counter : counters)
+        eObjects.push_back(&counter);
+    EObject::removeFromThread(eObjects);
+    if(counters[0].ref<Counter>().callQueued(&Counter::count))
+        throw std::runtime_error("a removed EObject is still reachable");
+}
@@ -0,0 +1,74 @@
+#include <ethread.h>
+#include <etimer.h>
+#include <epromise.h>
+#include <etrace.h>
+
+using namespace ethr;
+
+class Worker : public EObject
+{
+public:
+    int multiply(int n)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        return n*2;
+    }
+};
+
+class App : public EObject
+{
+public:
+    App()
+    {
+        for(int i=0; i<3; i++)
+        {
+            threads[i].setName("worker " + std::to_string(i));
+            workers[i].moveToThread(threads[i]);
+            threads[i].start();
+        }
+        mTimer.moveToThread(EThread::mainThread());
+        mTimer.addTask(0, std::chrono::milliseconds(20), this->uref(), [&]
+        {
+            auto promise = new EPromise(workers[0].ref<Worker>(), &Worker::multiply);
+            promise
+                    ->then(workers[1].ref<Worker>(), &Worker::multiply)
+                    ->then(workers[2].ref<Worker>(), &Worker::multiply)
+                    ->then<int>(this->uref(), [](int n){ std::cout<<"result: "<<n<<std::endl; return n; });
+            promise->execute(1);
+        }, 5);
+        mTimer.addTask(1, std::chrono::milliseconds(200), this->uref(), []
+        {
+            EThread::stopMainThread();
+        }, 1);
+        mTimer.start();
+    }
+    ~App()
+    {
+        mTimer.removeFromThread();
+        for(auto & worker : workers)
+            worker.removeFromThread();
+        for(auto & thread : threads)
+            thread.stop();
+    }
+private:
+    ETimer mTimer;
+    Worker workers[3];
+    EThread threads[3];
+};
+
+int main()
+{
+    ETracer::start();
+    {
+        EThread mainThread("main");
+        EThread::provideMainThread(mainThread);
+        App app;
+        app.moveToThread(mainThread);
+        mainThread.start();
+        app.removeFromThread();
+    }
+    ETracer::stop();
+
+    if(ETracer::dump("event_thread_trace.json"))
+        std::cout<<"trace written to event_thread_trace.json. open it in https://ui.perfetto.dev"<<std::endl;
+}
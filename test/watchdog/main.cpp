@@ -0,0 +1,36 @@
+#include <ethread.h>
+
+using namespace ethr;
+
+class Worker : public EObject
+{
+public:
+    void work(int milliseconds)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+    }
+};
+
+int main()
+{
+    EThread workerThread("worker");
+    workerThread.setSlowEventWatchdog(std::chrono::milliseconds(20), [](const EThread::SlowEventReport &report)
+    {
+        std::cout<<"slow event on "<<report.threadName
+            <<" EObject("<<report.eObjectId<<", "<<(report.callable ? report.callable->name() : "task()")<<")"
+            <<" took "<<std::chrono::duration_cast<std::chrono::milliseconds>(report.elapsed).count()<<"ms"<<std::endl;
+        for(const auto& frame : report.stack)
+            std::cout<<"    "<<frame<<std::endl;
+    }, true);
+    Worker worker;
+    worker.moveToThread(workerThread);
+    workerThread.start();
+
+    worker.callQueued(&Worker::work, 1);
+    worker.callQueued(&Worker::work, 50);
+    worker.callQueued(&Worker::work, 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    workerThread.stop();
+    worker.removeFromThread();
+}